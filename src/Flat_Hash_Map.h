@@ -0,0 +1,178 @@
+#pragma once
+
+#include "error_and_message_macros.h"
+#include <cstdint>
+#include <functional>
+#include <utility>
+#include <vector>
+
+// Finalizer from MurmurHash3. Every input bit reaches every output bit so keys
+// that only differ in a few low bits, like pointers, don't cluster.
+inline std::uint64_t mix_hash(std::uint64_t h)
+{
+  h ^= h >> 33;
+  h *= 0xff51afd7ed558ccdULL;
+  h ^= h >> 33;
+  h *= 0xc4ceb9fe1a85ec53ULL;
+  h ^= h >> 33;
+  return h;
+}
+
+// Order dependent combination of two hashes
+inline std::uint64_t combine_hashes(const std::uint64_t a, const std::uint64_t b)
+{
+  return mix_hash(a + 0x9e3779b97f4a7c15ULL * (mix_hash(b) + 1));
+}
+
+// Open addressing hash table. Entries live contiguously in insertion order and
+// a power of two slot array holds their positions, probed linearly. Lookups
+// touch one or two cache lines instead of walking bucket chains and iteration
+// is a plain vector walk. There is no erase, the containers this backs are
+// built up and then read.
+template <typename Key, typename Entry, typename Hash, typename Get_Key>
+class Flat_Hash_Table {
+  public:
+  using iterator       = typename std::vector<Entry>::iterator;
+  using const_iterator = typename std::vector<Entry>::const_iterator;
+
+  private:
+  enum { EMPTY = -1 };
+
+  std::vector<Entry> entries;
+  std::vector<int> slots = std::vector<int>(8, EMPTY);
+  Hash hasher;
+
+  std::size_t mask() const { return slots.size() - 1; }
+
+  std::size_t home_slot(const Key& key) const
+  {
+    // Mixed again so identity hashes (std::hash on pointers) still spread
+    return mix_hash(hasher(key)) & mask();
+  }
+
+  // Slot holding key or the empty slot it would go in
+  std::size_t find_slot(const Key& key) const
+  {
+    std::size_t i = home_slot(key);
+    while (slots[i] != EMPTY && !(Get_Key()(entries[slots[i]]) == key)) i = (i + 1) & mask();
+    return i;
+  }
+
+  void rehash(const std::size_t n_slots)
+  {
+    slots.assign(n_slots, EMPTY);
+    for (std::size_t pos = 0; pos < entries.size(); pos++) {
+      std::size_t i = home_slot(Get_Key()(entries[pos]));
+      while (slots[i] != EMPTY) i = (i + 1) & mask();
+      slots[i] = pos;
+    }
+  }
+
+  protected:
+  template <typename... Args>
+  std::pair<iterator, bool> insert_entry(const Key& key, Args&&... args)
+  {
+    std::size_t i = find_slot(key);
+    if (slots[i] != EMPTY) return std::make_pair(entries.begin() + slots[i], false);
+
+    // Keep load at or under one half so probe runs stay short. Only new keys
+    // can push it over so the lookup above never pays for a rehash.
+    if (2 * (entries.size() + 1) > slots.size()) {
+      rehash(2 * slots.size());
+      i = find_slot(key);
+    }
+
+    slots[i] = entries.size();
+    entries.emplace_back(std::forward<Args>(args)...);
+    return std::make_pair(entries.end() - 1, true);
+  }
+
+  public:
+  std::size_t size() const { return entries.size(); }
+  bool empty() const { return entries.empty(); }
+
+  iterator begin() { return entries.begin(); }
+  iterator end() { return entries.end(); }
+  const_iterator begin() const { return entries.begin(); }
+  const_iterator end() const { return entries.end(); }
+
+  void reserve(const std::size_t n)
+  {
+    entries.reserve(n);
+    std::size_t n_slots = slots.size();
+    while (n_slots < 2 * n) n_slots *= 2;
+    if (n_slots != slots.size()) rehash(n_slots);
+  }
+
+  void clear()
+  {
+    entries.clear();
+    slots.assign(slots.size(), EMPTY);
+  }
+
+  iterator find(const Key& key)
+  {
+    const int pos = slots[find_slot(key)];
+    return pos == EMPTY ? entries.end() : entries.begin() + pos;
+  }
+
+  const_iterator find(const Key& key) const
+  {
+    const int pos = slots[find_slot(key)];
+    return pos == EMPTY ? entries.end() : entries.begin() + pos;
+  }
+
+  std::size_t count(const Key& key) const { return slots[find_slot(key)] != EMPTY; }
+};
+
+template <typename Key, typename Value>
+struct Flat_Map_Key {
+  const Key& operator()(const std::pair<Key, Value>& entry) const { return entry.first; }
+};
+
+template <typename Key>
+struct Flat_Set_Key {
+  const Key& operator()(const Key& entry) const { return entry; }
+};
+
+// Drop in for the parts of std::unordered_map the model uses
+template <typename Key, typename Value, typename Hash = std::hash<Key>>
+class Flat_Hash_Map : public Flat_Hash_Table<Key, std::pair<Key, Value>, Hash, Flat_Map_Key<Key, Value>> {
+  public:
+  using value_type = std::pair<Key, Value>;
+  using iterator   = typename std::vector<value_type>::iterator;
+
+  std::pair<iterator, bool> emplace(const Key& key, const Value& value)
+  {
+    return this->insert_entry(key, key, value);
+  }
+
+  std::pair<iterator, bool> insert(const value_type& entry)
+  {
+    return this->insert_entry(entry.first, entry);
+  }
+
+  Value& operator[](const Key& key)
+  {
+    return this->insert_entry(key, key, Value()).first->second;
+  }
+
+  const Value& at(const Key& key) const
+  {
+    const auto it = this->find(key);
+    if (it == this->end()) RANGE_ERROR("Key not found in map");
+    return it->second;
+  }
+};
+
+// Drop in for the parts of std::unordered_set the model uses
+template <typename Key, typename Hash = std::hash<Key>>
+class Flat_Hash_Set : public Flat_Hash_Table<Key, Key, Hash, Flat_Set_Key<Key>> {
+  public:
+  using iterator = typename std::vector<Key>::iterator;
+
+  std::pair<iterator, bool> insert(const Key& key)
+  {
+    return this->insert_entry(key, key);
+  }
+};
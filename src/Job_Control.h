@@ -0,0 +1,97 @@
+#pragma once
+
+#include <atomic>
+#include <limits>
+#include <string>
+
+// =============================================================================
+// Background fitting jobs
+// =============================================================================
+// A job runs a sweep or collapse on a worker thread against its own copy of
+// the model (see SBM::start_sweep_job()). The worker reports progress through
+// a Job_Control that the owner polls and flags for cancellation. Nothing here
+// touches R so it is safe to use from any thread.
+
+enum Job_Kind { sweep_job,
+                collapse_job };
+
+enum Job_Status { job_running,
+                  job_finished,
+                  job_cancelled,
+                  job_failed };
+
+// Snapshot of a job's progress
+struct Job_Progress {
+  std::string kind;
+  std::string status;
+  int step               = 0;   // Sweeps or merge steps finished
+  int n_steps            = 0;   // Sweeps asked for (0 for collapses, their length isn't known up front)
+  int n_blocks           = 0;   // Blocks at the level being fit
+  double entropy         = 0.0; // Entropy of the job's model after the last finished step
+  double acceptance_rate = std::numeric_limits<double>::quiet_NaN(); // Accepted over proposed node moves
+};
+
+// Shared between a job's worker and whoever is watching it. The worker's
+// model holds a pointer to it and checks in once per step.
+class Job_Control {
+  private:
+  std::atomic<bool> cancel_flag { false };
+  std::atomic<int> steps_done { 0 };
+  std::atomic<int> blocks { 0 };
+  std::atomic<double> current_entropy { 0.0 };
+  std::atomic<long long> n_proposed { 0 };
+  std::atomic<long long> n_accepted { 0 };
+
+  public:
+  const Job_Kind kind;
+  const int n_steps;
+
+  Job_Control(const Job_Kind k, const int steps)
+      : kind(k)
+      , n_steps(steps)
+  {
+  }
+
+  void request_cancel() { cancel_flag = true; }
+  bool cancel_requested() const { return cancel_flag; }
+
+  void set_entropy(const double entropy) { current_entropy = entropy; }
+  void set_n_blocks(const int n) { blocks = n; }
+
+  // A finished sweep. Sweeps run between merges of a collapse only count
+  // towards its acceptance rate.
+  void sweep_done(const double entropy_delta, const int n_blocks, const int proposed, const int accepted)
+  {
+    n_proposed += proposed;
+    n_accepted += accepted;
+    if (kind != sweep_job) return;
+
+    current_entropy = current_entropy + entropy_delta;
+    blocks          = n_blocks;
+    steps_done++;
+  }
+
+  void merge_step_done(const double entropy, const int n_blocks)
+  {
+    current_entropy = entropy;
+    blocks          = n_blocks;
+    steps_done++;
+  }
+
+  Job_Progress progress(const Job_Status status) const
+  {
+    static const char* status_names[] = { "running", "finished", "cancelled", "failed" };
+
+    Job_Progress snapshot;
+    snapshot.kind     = kind == sweep_job ? "sweep" : "collapse";
+    snapshot.status   = status_names[status];
+    snapshot.step     = steps_done;
+    snapshot.n_steps  = n_steps;
+    snapshot.n_blocks = blocks;
+    snapshot.entropy  = current_entropy;
+
+    const long long proposed = n_proposed;
+    if (proposed > 0) snapshot.acceptance_rate = double(n_accepted) / proposed;
+    return snapshot;
+  }
+};
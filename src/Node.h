@@ -1,5 +1,6 @@
 // [[Rcpp::plugins(cpp11)]]
 #pragma once
+#include "Flat_Hash_Map.h"
 #include "error_and_message_macros.h"
 #include "vector_helpers.h"
 
@@ -19,17 +20,38 @@ using string = std::string;
 template <typename T>
 inline string as_str(const T& val) { return std::to_string(val); }
 
+// A neighboring node and how many edges connect to it
+struct Neighbor {
+  Node* node;
+  int weight;
+};
+
 // For a bit of clarity
 using Node_UPtr      = std::unique_ptr<Node>;
 using Node_UPtr_Vec  = std::vector<Node_UPtr>;
 using Node_Ptr_Vec   = std::vector<Node*>;
-using Edges_By_Type  = std::vector<Node_Ptr_Vec>;
+using Neighbor_Vec   = std::vector<Neighbor>;
 using Node_Vec       = std::vector<Node*>;
-using Edge_Count_Map = std::map<const Node*, int>;
 using Type_Vec       = std::vector<std::vector<Node_UPtr>>;
 
-enum Update_Type { Add,
-                   Remove };
+// Orders nodes by when the model created them so walks over block edge
+// counts, and with them seeded runs, don't depend on where nodes happen to sit
+// in memory. Nodes built without a creation index fall back to address order.
+struct Creation_Order {
+  bool operator()(const Node* a, const Node* b) const;
+};
+using Edge_Count_Map = std::map<const Node*, int, Creation_Order>;
+
+// How node types are wired together. When every type connects to at most one
+// type, as in unipartite and bipartite networks, the neighbors of a node's
+// neighbors all share the node's type and proposals can skip type checks.
+// Sweep and merge code is compiled separately for each layout.
+enum Type_Layout { single_neighbor_type,
+                   mixed_neighbor_types };
+
+// Neighbor lists longer than this get an index from neighbor to position so
+// adding edges to a hub doesn't rescan its whole list
+const int NEIGHBOR_INDEX_THRESHOLD = 32;
 
 //=================================
 // Main node class declaration
@@ -37,12 +59,18 @@ enum Update_Type { Add,
 class Node {
   private:
   Node* parent_node = nullptr; // What node contains this node (aka its cluster)
-  int _degree       = 0;       // How many neighbors does this node have?
+  int _serial       = 0;       // Creation index within the model (0 = unset), read by Creation_Order
+  int _degree       = 0;       // How many edges does this node have? (sum of edge weights)
+  int _n_self_edges = 0;       // Data nodes only: self loops (counted at both ends)
   Node_Vec _children;          // Nodes that are contained within node (if node is cluster)
   string _id;                  // Unique integer id for node
   int _level;                  // What level does this node sit at (0 = data, 1 = cluster, 2 = super-clusters, ...)
   int _type;                   // What type of node is this?
-  Edges_By_Type _neighbors;
+  Neighbor_Vec _neighbors;     // Data nodes only: each neighbor once with its edge count
+  std::unique_ptr<Flat_Hash_Map<const Node*, int>> _neighbor_slot; // Position in _neighbors, long lists only
+  Edge_Count_Map _block_edges; // Blocks only: edge counts to other blocks at same level (internal edges counted twice)
+  Node_Vec _ancestors;         // Ancestor at level _level + 1 + i in slot i (kept current by set_parent)
+  Node_Vec* _empty_list = nullptr; // Blocks only: list to sit in whenever block has no children
 
   public:
   // =========================================================================
@@ -51,11 +79,11 @@ class Node {
   Node(const string& node_id,
        const int level,
        const int type,
-       const int n_types = 1)
-      : _id(node_id)
+       const int serial = 0)
+      : _serial(serial)
+      , _id(node_id)
       , _level(level)
       , _type(type)
-      , _neighbors(n_types)
   {
   }
 
@@ -63,6 +91,7 @@ class Node {
   ~Node()
   {
     std::for_each(_children.begin(), _children.end(), [](Node* c) { c->remove_parent(); });
+    track_emptiness(nullptr);
   }
 
   // Disable costly copy and move methods for error protection
@@ -80,6 +109,7 @@ class Node {
   Node* parent() const { return parent_node; }
   int degree() const { return _degree; }
   int level() const { return _level; }
+  int serial() const { return _serial; }
 
   // =========================================================================
   // Children-Related methods
@@ -92,17 +122,18 @@ class Node {
   void add_child(Node* child)
   {
     _children.push_back(child);
+    if (_empty_list && _children.size() == 1) delete_from_vector(*_empty_list, this);
 
-    // Add new child's neighbors
-    update_neighbors(child->neighbors(), Add);
+    // Child's edges now belong to this block and its ancestors
+    change_degree(child->degree());
   }
 
   void remove_child(Node* child)
   {
     delete_from_vector(_children, child);
+    if (_empty_list && _children.empty()) _empty_list->push_back(this);
 
-    // Remove child's neighbors
-    update_neighbors(child->neighbors(), Remove);
+    change_degree(-child->degree());
   }
 
   int n_children() const
@@ -129,8 +160,20 @@ class Node {
 
   void empty_children()
   {
+    if (_empty_list && !_children.empty()) _empty_list->push_back(this);
+
     // Remove all children from vector
     _children.clear();
+    change_degree(-_degree);
+  }
+
+  // Keep block listed in empty_list whenever it has no children so empty
+  // blocks can be found without scanning a whole level. Pass nullptr to stop.
+  void track_emptiness(Node_Vec* empty_list)
+  {
+    if (_empty_list && is_empty()) delete_from_vector(*_empty_list, this);
+    _empty_list = empty_list;
+    if (_empty_list && is_empty()) _empty_list->push_back(this);
   }
 
   // =========================================================================
@@ -140,6 +183,8 @@ class Node {
   {
     if (_level != new_parent->level() - 1) LOGIC_ERROR("Parent node must be one level above child");
 
+    Node* old_parent = parent_node;
+
     // Remove self from previous parent's children list (if it existed)
     if (remove_from_old && has_parent()) parent_node->remove_child(this);
 
@@ -148,6 +193,18 @@ class Node {
 
     // Set this node's parent
     parent_node = new_parent;
+    refresh_ancestors();
+
+    // Keep the block-to-block edge counts of both parents (and their ancestors) current
+    move_block_edges(old_parent, new_parent);
+  }
+
+  // Like parent_at_level() but returns nullptr if the chain of parents stops
+  // before reaching desired level instead of erroring.
+  Node* ancestor_at_level(const int level_of_parent) const
+  {
+    const int ancestor_i = level_of_parent - _level - 1;
+    return ancestor_i >= 0 && ancestor_i < int(_ancestors.size()) ? _ancestors[ancestor_i] : nullptr;
   }
 
   // Get parent of node at a given level
@@ -160,93 +217,281 @@ class Node {
                                               + ") lower than current node level ("
                                               + as_str(_level) + ").");
 
-    // Start with this node as current node
-    Node* cur_node     = parent_node;
-    int cur_node_level = _level + 1;
-
-    while (cur_node_level != level_of_parent && cur_node->has_parent()) {
-      // Traverse up parents until we've reached just below where we want to go
-      cur_node = cur_node->parent();
-      cur_node_level++;
-    }
+    Node* ancestor = ancestor_at_level(level_of_parent);
 
-    if (cur_node_level != level_of_parent) RANGE_ERROR("No parent at level "
-                                                       + as_str(level_of_parent)
-                                                       + " for " + id());
+    if (ancestor == nullptr) RANGE_ERROR("No parent at level "
+                                         + as_str(level_of_parent)
+                                         + " for " + id());
 
-    // Return the final node, aka the parent at desired level
-    return cur_node;
+    return ancestor;
   }
 
+  const Node_Vec& ancestors() const { return _ancestors; }
+
   bool has_parent() const { return parent_node != nullptr; }
 
-  void remove_parent() { parent_node = nullptr; }
+  void remove_parent()
+  {
+    parent_node = nullptr;
+    refresh_ancestors();
+  }
 
   // =========================================================================
   // Neighbor-Related methods
   // =========================================================================
-  const Edges_By_Type& neighbors() const
+  const Neighbor_Vec& neighbors() const
   {
     return _neighbors;
   }
 
-  const Node_Ptr_Vec& neighbors_of_type(const int node_type) const
+  // Neighbors of all types share one list, this copies out those of one type
+  Neighbor_Vec neighbors_of_type(const int node_type) const
   {
-    return _neighbors.at(node_type);
+    Neighbor_Vec of_type;
+    for (const auto& neighbor : _neighbors) {
+      if (neighbor.node->type() == node_type) of_type.push_back(neighbor);
+    }
+    return of_type;
   }
 
   // Collapse neighbors to a given level into a map of connected block id->count
   Edge_Count_Map gather_neighbors_at_level(const int level) const
   {
+    // Blocks already know their counts to other blocks at their level so we
+    // can build from those instead of walking every data-level edge
+    if (_level > 0 && level >= _level) {
+      if (level == _level) return _block_edges;
+
+      Edge_Count_Map counts;
+      for (const auto& block_count : _block_edges) {
+        counts[block_count.first->parent_at_level(level)] += block_count.second;
+      }
+      return counts;
+    }
+
     // Setup an neighbor count map for node
     Edge_Count_Map counts;
 
-    for_all_neighbors([&](const Node* n) { counts[n->parent_at_level(level)]++; });
+    for_all_neighbors([&](const Node* n, const int weight) { counts[n->parent_at_level(level)] += weight; });
 
     return counts;
   }
 
-  void add_neighbor(Node* node)
+  const Edge_Count_Map& block_edges() const
+  {
+    return _block_edges;
+  }
+
+  // Repeated edges to the same node are kept as one neighbor with a larger
+  // weight. Self-edges are added at both ends so get counted twice.
+  void add_neighbor(Node* node, const int weight = 1)
   {
-    _neighbors.at(node->type()).push_back(node);
-    _degree++;
+    const int slot = neighbor_slot(node);
+    if (slot == -1) {
+      append_neighbor(node, weight);
+    } else {
+      _neighbors[slot].weight += weight;
+    }
+    count_new_edges(node, weight);
   }
 
-  void update_neighbors(const Edges_By_Type& neighbors_to_update, const Update_Type& update_type)
+  // Same as add_neighbor() for callers that know node isn't a neighbor yet
+  void add_new_neighbor(Node* node, const int weight = 1)
   {
+    append_neighbor(node, weight);
+    count_new_edges(node, weight);
+  }
 
-    int type_i = 0;
+  private:
+  // Position of node in neighbor list, -1 if it isn't there
+  int neighbor_slot(const Node* node) const
+  {
+    if (_neighbor_slot) {
+      const auto slot_it = _neighbor_slot->find(node);
+      return slot_it == _neighbor_slot->end() ? -1 : slot_it->second;
+    }
 
-    for (const auto& nodes_of_type : neighbors_to_update) {
-      // Get references to this node's neighbors to type (update type for next go-round)
-      auto& node_neighbors_of_type = _neighbors.at(type_i++);
+    for (std::size_t i = 0; i < _neighbors.size(); i++) {
+      if (_neighbors[i].node == node) return i;
+    }
+    return -1;
+  }
 
-      for (const auto& node : nodes_of_type) {
-        switch (update_type) {
-        case Remove:
-          delete_from_vector(node_neighbors_of_type, node);
-          _degree--;
-          break;
-        case Add:
-          node_neighbors_of_type.push_back(node);
-          _degree++;
-          break;
-        }
+  void append_neighbor(Node* node, const int weight)
+  {
+    _neighbors.push_back(Neighbor { node, weight });
+
+    if (_neighbor_slot) {
+      _neighbor_slot->emplace(node, _neighbors.size() - 1);
+    } else if (_neighbors.size() > NEIGHBOR_INDEX_THRESHOLD) {
+      _neighbor_slot.reset(new Flat_Hash_Map<const Node*, int>());
+      _neighbor_slot->reserve(2 * _neighbors.size());
+      for (std::size_t i = 0; i < _neighbors.size(); i++) _neighbor_slot->emplace(_neighbors[i].node, i);
+    }
+  }
+
+  void count_new_edges(Node* node, const int weight)
+  {
+    _degree += weight;
+    if (node == this) _n_self_edges += weight;
+
+    // Edges added after blocks are assigned get counted by this end's blocks
+    // right away. The far end adds its side when it calls this in turn.
+    for (Node* block : _ancestors) {
+      block->_degree += weight;
+
+      // Unassigned far ends get their edges counted once they have a block
+      Node* other_block = node->ancestor_at_level(block->level());
+      if (other_block) block->change_block_edges(other_block, weight);
+    }
+  }
+
+  public:
+  // Edges from node to itself, counted at both ends like a block's internal
+  // edges. These move along with the node when it changes blocks.
+  int self_edge_count() const
+  {
+    if (_level == 0) return _n_self_edges;
+
+    const auto self_it = _block_edges.find(this);
+    return self_it == _block_edges.end() ? 0 : self_it->second;
+  }
+
+  // Apply a function taking (neighbor, n_edges) to every data-level neighbor
+  // of node. Blocks visit their children's neighbors. Templated on the
+  // callable so the call can be inlined in hot loops.
+  template <typename Visit_Fn>
+  void for_all_neighbors(Visit_Fn&& fn) const
+  {
+    if (_level > 0) {
+      for (const Node* child : _children) child->for_all_neighbors(fn);
+      return;
+    }
+
+    for (const auto& neighbor : _neighbors) fn(neighbor.node, neighbor.weight);
+  }
+
+  // =========================================================================
+  // Bulk rewrites
+  // =========================================================================
+  // For writing back a partition that was worked on elsewhere (see
+  // Partition_Arrays) in one pass. Each only sets what it's given, keeping
+  // parents, children, degrees, and counts consistent is up to the caller.
+  void point_to_parent(Node* new_parent)
+  {
+    parent_node = new_parent;
+    refresh_ancestors();
+  }
+
+  void set_children(Node_Vec children)
+  {
+    const bool was_empty = is_empty();
+    _children            = std::move(children);
+
+    if (_empty_list && was_empty != is_empty()) {
+      if (is_empty()) {
+        _empty_list->push_back(this);
+      } else {
+        delete_from_vector(*_empty_list, this);
       }
     }
+  }
+
+  void set_degree(const int degree) { _degree = degree; }
+
+  void set_block_edges(const Node* block, const int n_edges)
+  {
+    if (n_edges == 0) {
+      _block_edges.erase(block);
+    } else {
+      _block_edges[block] = n_edges;
+    }
+  }
+
+  // =========================================================================
+  // Ancestor table maintenance
+  // =========================================================================
+  private:
+  // Rebuild ancestor table from parent's and pass the change down to all
+  // descendants, as their ancestors above this node have changed too
+  void refresh_ancestors()
+  {
+    _ancestors.clear();
+    if (parent_node != nullptr) {
+      _ancestors.reserve(parent_node->_ancestors.size() + 1);
+      _ancestors.push_back(parent_node);
+      _ancestors.insert(_ancestors.end(),
+                        parent_node->_ancestors.begin(),
+                        parent_node->_ancestors.end());
+    }
+
+    for (Node* child : _children) child->refresh_ancestors();
+  }
+
+  // =========================================================================
+  // Block edge count maintenance
+  // =========================================================================
+
+  void change_degree(const int amount)
+  {
+    for (Node* block = this; block != nullptr; block = block->parent_node) block->_degree += amount;
+  }
+
+  void change_block_edges(const Node* block, const int amount)
+  {
+    const int new_count = (_block_edges[block] += amount);
+    if (new_count == 0) _block_edges.erase(block);
+  }
 
-    // Propagate edge changes up hierarchy
-    if (has_parent()) parent_node->update_neighbors(neighbors_to_update, update_type);
+  // Runs a function over every edge of node to other nodes at the same level.
+  // Data nodes use their neighbors, blocks use their block edge counts
+  template <typename Edge_Fn>
+  void for_all_edges_at_own_level(Edge_Fn fn) const
+  {
+    if (_level == 0) {
+      for_all_neighbors(fn);
+    } else {
+      for (const auto& block_count : _block_edges) fn(block_count.first, block_count.second);
+    }
   }
 
-  // Apply a lambda function over all nodes in network
-  void for_all_neighbors(std::function<void(const Node* node)> fn) const
+  // Moves this node's contribution to block edge counts from old block to new
+  // block. Repeats up the hierarchy until the old and new ancestors match.
+  // Either block can be nullptr (e.g. when node is first given a parent)
+  void move_block_edges(Node* old_block, Node* new_block)
   {
-    for (const auto& neighbors_of_type : _neighbors) {
-      std::for_each(neighbors_of_type.begin(), neighbors_of_type.end(), fn);
+    int block_level = _level + 1;
+
+    while (old_block != new_block) {
+      for_all_edges_at_own_level([&](const Node* other, const int n_edges) {
+        if (other == this) {
+          if (old_block) old_block->change_block_edges(old_block, -n_edges);
+          if (new_block) new_block->change_block_edges(new_block, n_edges);
+          return;
+        }
+
+        // The other end's block may not be assigned yet, in which case the
+        // edges get counted once it is
+        Node* other_block = other->ancestor_at_level(block_level);
+        if (other_block == nullptr) return;
+
+        if (old_block) {
+          old_block->change_block_edges(other_block, -n_edges);
+          other_block->change_block_edges(old_block, -n_edges);
+        }
+        if (new_block) {
+          new_block->change_block_edges(other_block, n_edges);
+          other_block->change_block_edges(new_block, n_edges);
+        }
+      });
+
+      old_block = old_block ? old_block->parent() : nullptr;
+      new_block = new_block ? new_block->parent() : nullptr;
+      block_level++;
     }
   }
 
+  public:
   // =========================================================================
   // Comparison operators
   // =========================================================================
@@ -254,11 +499,16 @@ class Node {
   bool operator==(const Node& other_node) const { return id() == other_node.id(); }
 };
 
+inline bool Creation_Order::operator()(const Node* a, const Node* b) const
+{
+  return a->serial() != b->serial() ? a->serial() < b->serial() : a < b;
+}
+
 // =============================================================================
 // Static method to connect two nodes to each other with an edge
 // =============================================================================
-inline void connect_nodes(Node* node_a, Node* node_b)
+inline void connect_nodes(Node* node_a, Node* node_b, const int weight = 1)
 {
-  node_a->add_neighbor(node_b);
-  node_b->add_neighbor(node_a);
+  node_a->add_neighbor(node_b, weight);
+  node_b->add_neighbor(node_a, weight);
 }
@@ -1,8 +1,13 @@
 #pragma once
 
+#include "Flat_Hash_Map.h"
+#include <functional>
+#include <unordered_map>
 #include <unordered_set>
 
-template <typename T>
+// Less decides which value goes first. Pointer pairs that need an order that
+// doesn't depend on where things sit in memory can pass their own.
+template <typename T, typename Less = std::less<T>>
 class Ordered_Pair {
   private:
   T val_1;
@@ -10,8 +15,8 @@ class Ordered_Pair {
 
   public:
   Ordered_Pair(const T a, const T b)
-      : val_1(a < b ? a : b)
-      , val_2(a < b ? b : a)
+      : val_1(Less()(a, b) ? a : b)
+      , val_2(Less()(a, b) ? b : a)
   {
   }
 
@@ -23,35 +28,46 @@ class Ordered_Pair {
   bool is_matching() const { return val_1 == val_2; }
 };
 
-template <typename T>
-bool operator==(const Ordered_Pair<T>& a, const Ordered_Pair<T>& b)
+template <typename T, typename Less>
+bool operator==(const Ordered_Pair<T, Less>& a, const Ordered_Pair<T, Less>& b)
 {
   return a.first() == b.first() && a.second() == b.second();
 }
 
-template <typename T>
-bool operator<(const Ordered_Pair<T>& a, const Ordered_Pair<T>& b)
+template <typename T, typename Less>
+bool operator<(const Ordered_Pair<T, Less>& a, const Ordered_Pair<T, Less>& b)
 {
   // If the first value is same as second, then check the second
   if (a.first() == b.first()) {
-    return a.second() < b.second();
+    return Less()(a.second(), b.second());
   } else {
-    return a.first() < b.first();
+    return Less()(a.first(), b.first());
   }
 }
 
 // Hash function for ordered pairs so they can be used in hashed containers like
-// unordered_map and unordered_set
-template <typename T>
+// unordered_map and unordered_set. The two halves are mixed rather than xor-ed
+// so neighboring pointers and (a, a) pairs don't collide.
+template <typename T, typename Less = std::less<T>>
 struct Ordered_Pair_Hash {
-  size_t operator()(const Ordered_Pair<T>& p) const
+  size_t operator()(const Ordered_Pair<T, Less>& p) const
   {
-    return std::hash<T>()(p.first()) ^ std::hash<T>()(p.second());
+    return combine_hashes(std::hash<T>()(p.first()), std::hash<T>()(p.second()));
   }
 };
 
+// Pair containers default to the flat open addressing tables. Define
+// SBMR_STD_HASH_MAPS to fall back to the standard library node based ones.
+#ifdef SBMR_STD_HASH_MAPS
+template <typename T, typename Less = std::less<T>>
+using Ordered_Pair_Set = std::unordered_set<Ordered_Pair<T, Less>, Ordered_Pair_Hash<T, Less>>;
+
 template <typename T>
-using Ordered_Pair_Set = std::unordered_set<Ordered_Pair<T>, Ordered_Pair_Hash<T>>;
+using Ordered_Pair_Int_Map = std::unordered_map<Ordered_Pair<T>, int, Ordered_Pair_Hash<T>>;
+#else
+template <typename T, typename Less = std::less<T>>
+using Ordered_Pair_Set = Flat_Hash_Set<Ordered_Pair<T, Less>, Ordered_Pair_Hash<T, Less>>;
 
 template <typename T>
-using Ordered_Pair_Int_Map = std::unordered_map<Ordered_Pair<T>, int, Ordered_Pair_Hash<T>>;
\ No newline at end of file
+using Ordered_Pair_Int_Map = Flat_Hash_Map<Ordered_Pair<T>, int, Ordered_Pair_Hash<T>>;
+#endif
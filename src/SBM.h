@@ -2,15 +2,24 @@
 
 // Helper classes
 #include "Block_Consensus.h"
+#include "Job_Control.h"
 #include "Node.h"
 #include "Sampler.h"
+#include "checkpoint_io.h"
+#include "partition_arrays.h"
 
 // Helper functions
 #include "agglomerative_merge.h"
 #include "get_move_results.h"
 #include "vector_helpers.h"
 
+#include <chrono>
+#include <exception>
+#include <limits>
+#include <sstream>
+#include <thread>
 #include <unordered_map>
+#include <unordered_set>
 
 template <typename T>
 using String_Map = std::unordered_map<string, T>;
@@ -50,15 +59,24 @@ class State_Dump {
   int size() const { return ids.size(); }
 };
 
+// Partition of every block level as integer parent indices. Entry i of level
+// l is the index of node i's parent among the nodes of level l + 1. Data nodes
+// are indexed in the order they were added to the network and blocks in the
+// order they first appear as a parent in the level below. Ids are left out and
+// fetched separately if needed (see data_node_ids()).
+using Compact_State = std::vector<std::vector<int>>;
+
+// Sweep results are held in plain std containers so sweeps can run off of the
+// main R thread (e.g. for replica exchange). They get converted on export.
 class MCMC_Sweeps {
   private:
   int i = 0;
 
   public:
-  InOut_Double_Vec entropy_deltas;
-  InOut_Int_Vec n_nodes_moved;
+  std::vector<double> entropy_deltas;
+  std::vector<int> n_nodes_moved;
   Block_Consensus block_consensus;
-  InOut_String_Vec nodes_moved;
+  std::vector<string> nodes_moved;
   double entropy_delta = 0.0;
   MCMC_Sweeps(const int n)
       : entropy_deltas(n)
@@ -71,6 +89,13 @@ class MCMC_Sweeps {
     n_nodes_moved[i]  = n_nodes;
     i++;
   }
+
+  // Drop the slots of sweeps that never ran
+  void stop_early()
+  {
+    entropy_deltas.resize(i);
+    n_nodes_moved.resize(i);
+  }
 };
 
 enum Partite_Structure {
@@ -79,18 +104,63 @@ enum Partite_Structure {
   multipartite_restricted // Multiple node types, only specific type combos allowed for edges
 };
 
+// Partitions visited by a collapse, held as the partition at the start plus
+// the nodes that changed blocks at each step. Blocks are identified by their
+// index in the starting partition as collapsing never creates new blocks.
+class Collapse_History {
+  public:
+  Compact_State initial_state;               // Levels up to and including the collapsed one
+  std::vector<std::vector<int>> moved_nodes; // Per step: index of each node that changed blocks
+  std::vector<std::vector<int>> new_blocks;  // Per step: index of block each node moved into
+
+  void add_step(std::vector<int> moved, std::vector<int> blocks)
+  {
+    moved_nodes.push_back(std::move(moved));
+    new_blocks.push_back(std::move(blocks));
+  }
+
+  int size() const { return moved_nodes.size(); }
+
+  // Rebuild the partition after a given step by replaying all steps up to it
+  Compact_State at(const int step) const
+  {
+    if (step < 0 || step >= size()) RANGE_ERROR("Collapse history has no step " + as_str(step));
+
+    Compact_State state   = initial_state;
+    std::vector<int>& top = state.back();
+
+    for (int s = 0; s <= step; s++) {
+      for (int i = 0; i < moved_nodes[s].size(); i++) {
+        top[moved_nodes[s][i]] = new_blocks[s][i];
+      }
+    }
+
+    // Merges leave gaps in block indices so renumber by order of appearance
+    std::unordered_map<int, int> renumbered;
+    for (int& block : top) block = renumbered.emplace(block, renumbered.size()).first->second;
+
+    return state;
+  }
+};
+
 struct Collapse_Results {
   double entropy_delta = 0; // Will keep track of the overall entropy change from this collapse
   double final_entropy = 0;
   int n_blocks;
   std::vector<Block_Mergers> merge_steps; // Will keep track of results at each step of the merger
-  std::vector<State_Dump> states;
+  Collapse_History states;                // Partition after each step (or just the last)
   Collapse_Results(const int n)
       : n_blocks(n)
   {
   }
 };
 
+struct Nested_Results {
+  std::vector<int> n_blocks;                // Number of blocks at each level above the data
+  std::vector<double> level_entropy;        // Entropy of each level's partition of the level below
+  std::vector<double> sweep_entropy_deltas; // Entropy change across all levels for each nested sweep
+};
+
 struct Block_Counts {
   InOut_String_Vec ids;
   InOut_Int_Vec counts;
@@ -101,26 +171,152 @@ struct Block_Counts {
   }
 };
 
+// Block pair edge counts as index triplets into a single block id lookup so
+// large block levels can be exported without a string per pair.
+struct Sparse_Edge_Counts {
+  InOut_String_Vec block_ids; // Id of block at each index
+  InOut_Int_Vec block_a;      // 0-based index into block_ids
+  InOut_Int_Vec block_b;      // 0-based index into block_ids (block_a <= block_b)
+  InOut_Int_Vec n_edges;
+  Sparse_Edge_Counts(const int n_blocks, const int n_pairs)
+      : block_ids(n_blocks)
+      , block_a(n_pairs)
+      , block_b(n_pairs)
+      , n_edges(n_pairs)
+  {
+  }
+};
+
+struct Tempering_Results {
+  std::vector<double> betas;
+  std::vector<double> cold_entropy;    // Entropy of the beta = 1 chain after each round
+  std::vector<int> n_swaps_proposed;   // Swap proposals between temperature i and i + 1
+  std::vector<int> n_swaps_accepted;   // Accepted swaps between temperature i and i + 1
+  std::vector<Compact_State> cold_states; // State of the cold chain after each round (if requested)
+  Tempering_Results(const std::vector<double>& b, const int n_rounds)
+      : betas(b)
+      , cold_entropy(n_rounds)
+      , n_swaps_proposed(b.size() - 1)
+      , n_swaps_accepted(b.size() - 1)
+  {
+  }
+};
+
+// A sweep or collapse running in the background and what it leaves behind.
+// Only the results slot for the job's kind gets filled.
+struct Fit_Job {
+  Job_Control control;
+  std::atomic<int> status { job_running };
+  std::unique_ptr<MCMC_Sweeps> sweep_results;
+  std::unique_ptr<Collapse_Results> collapse_results;
+  std::exception_ptr error;
+  std::thread worker;
+
+  Fit_Job(const Job_Kind kind, const int n_steps)
+      : control(kind, n_steps)
+  {
+  }
+
+  bool done() const { return status != job_running; }
+
+  // Jobs never outlive their owner, abandoned ones get stopped
+  ~Fit_Job()
+  {
+    control.request_cancel();
+    if (worker.joinable()) worker.join();
+  }
+};
+
+// Where a run of sweeps picks back up after a checkpoint
+struct Sweep_Resume {
+  int first_sweep;
+  MCMC_Sweeps results;
+  Node_Vec order; // Nodes in the order the last sweep shuffled them into
+
+  Sweep_Resume(const int n_sweeps)
+      : results(n_sweeps)
+  {
+  }
+};
+
+// What a collapse keeps to record its steps. Nodes being merged stay in the
+// order the history indexes them by.
+struct Collapse_Position {
+  int step = 0;
+  Node_Vec nodes;
+  std::vector<int> current_blocks;                  // Block index of each node as of the last recorded step
+  std::unordered_map<const Node*, int> block_index; // Each block's index in the starting partition
+};
+
+// Uniform draws consumed by one move proposal and its acceptance check, in
+// the order they sit in a sweep's draw batch. Every node visited takes all
+// n_move_draws of them whether it needs them or not, so the draws a node sees
+// only depend on the seed and its place in the sweep.
+enum Move_Draw { random_block_draw,  // Jump to a random block instead of a neighbor's?
+                 block_draw,         // Neighbor block's edge to follow, or the random block
+                 neighbor_edge_draw, // Edge of the node to find a neighbor block through
+                 accept_draw,        // Metropolis-Hastings acceptance
+                 n_move_draws };
+
 class SBM {
 
   private:
   // =========================================================================
   // Data/Attributes
   // =========================================================================
+  // Declared ahead of nodes so blocks can still take themselves off their
+  // empty list as they are destroyed
+  std::map<std::pair<int, int>, Node_Vec> empty_blocks; // (level, type) -> blocks without children
+
   std::vector<Type_Vec> nodes;
   std::vector<string> types;
   Int_Map<string> type_name_to_int;
-  std::map<int, std::set<int>> connection_types;
+  std::vector<char> type_adjacency; // Flat n_types x n_types, can two types share edges?
+  std::vector<std::vector<int>> neighbor_block_totals; // [level][type] -> nodes at level of connectable types
   String_Map<Node*> id_to_node;
+  Node_Vec data_nodes; // Data-level nodes in the order they were added
+
+  // Layout picked by reorder_nodes(). Sweeps over data nodes shuffle within
+  // runs of sweep_chunk_size nodes of locality_order (1 = plain shuffle).
+  string node_order;
+  Node_Vec locality_order;
+  int sweep_chunk_size = 1;
   Partite_Structure edge_types;
   Sampler sampler;
 
+  // Deleted empty blocks kept aside for reuse, per (level, type)
+  std::map<std::pair<int, int>, Node_UPtr_Vec> block_pool;
+  static const int BLOCK_POOL_SIZE = 4;
+
   // Keeps track of how many block we've had to avoid duplicate ids
   int block_counter = 0;
 
+  // Creation index handed to the next new node (see Creation_Order)
+  int node_serial = 0;
+
   // Keep track of how many edges we have in the model
   int _n_edges = 0;
 
+  // Can long running loops check back in with R? Needs to be false for
+  // networks that are being worked on outside of the main thread.
+  bool interruptible = true;
+
+  // Background fit, run on its own copy of the model. The worker is stopped
+  // before its model goes away as job is declared after job_model.
+  std::unique_ptr<SBM> job_model;
+  std::unique_ptr<Fit_Job> job;
+  Job_Control* job_control = nullptr; // Set on a job's copy of the model
+
+  // mcmc_sweep() and collapse_blocks() save their progress to checkpoint_path
+  // every checkpoint_every sweeps or merge steps (0 = never)
+  string checkpoint_path;
+  int checkpoint_every = 0;
+
+  // Data nodes added to a model with blocks and the ends of edges added to
+  // one, waiting for place_new_nodes() to fit them in
+  Node_Vec unplaced_nodes;
+  Node_Vec changed_nodes;
+
   public:
   // =========================================================================
   // Constructors
@@ -132,9 +328,13 @@ class SBM {
       const int random_seed = 42)
       : types(to_str_vec(all_types))
       , type_name_to_int(build_val_to_index_map(to_str_vec(all_types)))
+      , type_adjacency(all_types.size() * all_types.size(), false)
       , edge_types(all_types.size() == 1 ? unipartite : multipartite)
       , sampler(random_seed)
   {
+    // Unipartite nodes only ever connect to their own type
+    if (edge_types == unipartite) type_adjacency.assign(type_adjacency.size(), true);
+
     // Make sure we don't already have nodes
     if (n_levels() > 0) LOGIC_ERROR("Can only bulk add nodes to empty network");
 
@@ -170,17 +370,83 @@ class SBM {
   {
   }
 
+  // Build an independent copy of the network (nodes, edges, and block
+  // structure) that samples with its own random seed.
+  std::unique_ptr<SBM> clone(const int random_seed) const
+  {
+    auto all_types = InOut_String_Vec(n_types());
+    for (int t_i = 0; t_i < n_types(); t_i++) all_types[t_i] = types[t_i];
+
+    std::unique_ptr<SBM> copy(new SBM(all_types, random_seed));
+    copy->edge_types       = edge_types;
+    copy->type_adjacency   = type_adjacency;
+    copy->recount_nodes();
+
+    // Keep the same data node order so compact states can be passed across as is
+    for (const auto& node : data_nodes) copy->add_node(node->id(), node->type());
+
+    for_all_nodes_at_level(0, [&](const Node_UPtr& node) {
+      node->for_all_neighbors([&](const Node* neighbor, const int weight) {
+        // Every edge is seen from both of its ends, only add it from one side.
+        // Self-edges are counted at both ends of their one entry.
+        if (neighbor == node.get()) {
+          copy->add_edge(node->id(), neighbor->id(), weight / 2);
+        } else if (neighbor->id() > node->id()) {
+          copy->add_edge(node->id(), neighbor->id(), weight);
+        }
+      });
+    });
+
+    if (!node_order.empty()) copy->reorder_nodes(node_order, sweep_chunk_size);
+
+    // Go through string state so blocks keep their ids
+    if (n_levels() > 1) {
+      const State_Dump current_state = state();
+      copy->update_state(current_state.ids,
+                         current_state.types,
+                         current_state.parents,
+                         current_state.levels);
+    }
+
+    copy->block_counter = block_counter;
+
+    return copy;
+  }
+
   // Move constructor
   SBM(SBM&& moved_net)
   {
-    nodes            = std::move(moved_net.nodes);
-    types            = std::move(moved_net.types);
-    type_name_to_int = std::move(moved_net.type_name_to_int);
-    connection_types = std::move(moved_net.connection_types);
-    id_to_node       = std::move(moved_net.id_to_node);
-    edge_types       = std::move(moved_net.edge_types);
-    sampler          = std::move(moved_net.sampler);
-    block_counter    = moved_net.block_counter;
+    empty_blocks          = std::move(moved_net.empty_blocks);
+    nodes                 = std::move(moved_net.nodes);
+    types                 = std::move(moved_net.types);
+    type_name_to_int      = std::move(moved_net.type_name_to_int);
+    type_adjacency        = std::move(moved_net.type_adjacency);
+    neighbor_block_totals = std::move(moved_net.neighbor_block_totals);
+    id_to_node            = std::move(moved_net.id_to_node);
+    data_nodes            = std::move(moved_net.data_nodes);
+    node_order            = std::move(moved_net.node_order);
+    locality_order        = std::move(moved_net.locality_order);
+    sweep_chunk_size      = moved_net.sweep_chunk_size;
+    edge_types            = std::move(moved_net.edge_types);
+    sampler               = std::move(moved_net.sampler);
+    block_pool            = std::move(moved_net.block_pool);
+    block_counter         = moved_net.block_counter;
+    node_serial           = moved_net.node_serial;
+    _n_edges              = moved_net._n_edges;
+    interruptible         = moved_net.interruptible;
+    job_model             = std::move(moved_net.job_model);
+    job                   = std::move(moved_net.job);
+    job_control           = moved_net.job_control;
+    checkpoint_path       = std::move(moved_net.checkpoint_path);
+    checkpoint_every      = moved_net.checkpoint_every;
+    unplaced_nodes        = std::move(moved_net.unplaced_nodes);
+    changed_nodes         = std::move(moved_net.changed_nodes);
+  }
+
+  // Remove levels from the top down so blocks never reach into freed children
+  ~SBM()
+  {
+    while (!nodes.empty()) nodes.pop_back();
   }
 
   // =========================================================================
@@ -259,21 +525,26 @@ class SBM {
     return b_c;
   }
 
-  int n_possible_neighbor_blocks(Node* node) const
+  Type_Layout type_layout() const
   {
-    const int type  = node->type();
-    const int level = node->level();
-    if (edge_types == unipartite) return n_nodes_of_type(type, level + 1);
+    for (int type = 0; type < n_types(); type++) {
+      const auto row = type_adjacency.begin() + type * n_types();
+      if (std::count(row, row + n_types(), true) > 1) return mixed_neighbor_types;
+    }
+    return single_neighbor_type;
+  }
 
-    const std::set<int>& node_neighbor_types = connection_types.at(type);
+  // Number of blocks above the node that it could have edges to. Kept up to
+  // date as nodes come and go so proposals only pay for a lookup.
+  int n_possible_neighbor_blocks(Node* node) const
+  {
+    return n_possible_neighbor_blocks(node->type(), node->level() + 1);
+  }
 
-    return std::accumulate(
-        node_neighbor_types.begin(),
-        node_neighbor_types.end(),
-        0,
-        [&](int n, const int type) {
-          return n + n_nodes_of_type(type, level + 1);
-        });
+  int n_possible_neighbor_blocks(const int type, const int block_level) const
+  {
+    if (block_level >= neighbor_block_totals.size()) check_for_level(block_level);
+    return neighbor_block_totals[block_level][type];
   }
 
   Edge_Counts interblock_edge_counts(const int level) const
@@ -282,16 +553,48 @@ class SBM {
 
     auto counts = Edge_Counts();
 
-    auto gather_blocks_neighbors = [&](const Node_UPtr& block_i) {
-      block_i->for_all_neighbors([&](const Node* node_j) {
-        counts[Const_Node_Pair(block_i.get(),
-                               node_j->parent_at_level(level))]++;
-      });
-    };
-    for_all_nodes_at_level(level, gather_blocks_neighbors);
+    // Blocks keep their own counts to the other blocks at their level. Each
+    // pair is seen from both sides so only take it from the older block.
+    // Edges within a block are held twice in that block's counts.
+    for_all_block_pairs(level, [&](const Node* block_r, const Node* block_s, const int n_edges) {
+      counts.emplace(Const_Node_Pair(block_r, block_s), n_edges);
+    });
+
+    return counts;
+  }
+
+  Sparse_Edge_Counts sparse_interblock_edge_counts(const int level) const
+  {
+    if (level == 0) LOGIC_ERROR("Level 0 is not block level");
+    check_for_level(level);
+
+    std::unordered_map<const Node*, int> block_index;
+    block_index.reserve(n_nodes_at_level(level));
+
+    int n_pairs = 0;
+    for_all_nodes_at_level(level, [&](const Node_UPtr& block) {
+      block_index.emplace(block.get(), block_index.size());
+      for (const auto& block_count : block->block_edges()) {
+        if (!Creation_Order()(block_count.first, block.get())) n_pairs++;
+      }
+    });
+
+    auto counts = Sparse_Edge_Counts(block_index.size(), n_pairs);
+
+    for (const auto& block_i : block_index) {
+      counts.block_ids[block_i.second] = block_i.first->id();
+    }
+
+    int i = 0;
+    for_all_block_pairs(level, [&](const Node* block_r, const Node* block_s, const int n_edges) {
+      const int index_r = block_index.at(block_r);
+      const int index_s = block_index.at(block_s);
 
-    // Go through and divide all counts by two because we've double counted each edge
-    for (auto& pair_count : counts) pair_count.second /= 2;
+      counts.block_a[i] = std::min(index_r, index_s);
+      counts.block_b[i] = std::max(index_r, index_s);
+      counts.n_edges[i] = n_edges;
+      i++;
+    });
 
     return counts;
   }
@@ -326,21 +629,17 @@ class SBM {
 
     // Calculate first component (sum of node degree counts portion)
     for (const auto& degree_count : n_w_degree) {
-      // Using std's built in lgamma here: lgamma(x + 1) = log(x!)
-      entropy -= degree_count.second * lgamma(degree_count.first + 1);
+      // lgamma(x + 1) = log(x!)
+      entropy -= degree_count.second * lgamma_n_plus_1(degree_count.first);
     }
 
     // Counts between all pairs of blocks
-    Edge_Counts block_edge_counts = interblock_edge_counts(level + 1);
-
-    for (const auto& block_pair_count : block_edge_counts) {
-      const Node* block_r = block_pair_count.first.first();
-      const Node* block_s = block_pair_count.first.second();
-      const int scalar    = block_pair_count.first.is_matching() ? 2 : 1;
-      const int e_rs      = block_pair_count.second * scalar;
+    for_all_block_pairs(level + 1, [&](const Node* block_r, const Node* block_s, const int n_edges) {
+      const int scalar = block_r == block_s ? 2 : 1;
+      const int e_rs   = n_edges * scalar;
 
       entropy -= ent(e_rs, block_r->degree(), block_s->degree()) / scalar;
-    }
+    });
 
     return entropy;
   }
@@ -355,7 +654,9 @@ class SBM {
   {
     check_for_level(level);
 
-    if (node_level_has_blocks(level)) {
+    // Data nodes can join a fitted model (see place_new_nodes()) but blocks
+    // would be left without a parent
+    if (level > 0 && node_level_has_blocks(level)) {
       LOGIC_ERROR("Can't add a node to a network with block structure. This invalidates the model state. Remove block structure with reset_blocks() method.");
     }
 
@@ -365,7 +666,7 @@ class SBM {
     }
 
     // Build new node pointer outside vector for ease of pointer retrieval
-    auto new_node = Node_UPtr(new Node(id, level, type_index, n_types()));
+    auto new_node = Node_UPtr(new Node(id, level, type_index, ++node_serial));
 
     // Get raw pointer to node to return
     Node* node_ptr = new_node.get();
@@ -373,13 +674,24 @@ class SBM {
     if (level == 0) {
       // Place this node in the id-to-node map if its a data-level node
       id_to_node.emplace(id, node_ptr);
+      data_nodes.push_back(node_ptr);
+      if (!locality_order.empty()) locality_order.push_back(node_ptr);
     } else {
       // If node is block, increment up block counted
       block_counter++;
+      node_ptr->track_emptiness(&empty_blocks[std::make_pair(level, type_index)]);
     }
 
     // Move node unique pointer into its type in map
     nodes[level][type_index].push_back(std::move(new_node));
+    count_node(level, type_index, 1);
+
+    // Without edges the node fits any block equally well so it starts in a
+    // random one until place_new_nodes() finds it a better one
+    if (level == 0 && node_level_has_blocks(0)) {
+      node_ptr->set_parent(starting_block(type_index));
+      unplaced_nodes.push_back(node_ptr);
+    }
 
     return node_ptr;
   }
@@ -387,16 +699,95 @@ class SBM {
   template <typename Node_Ref>
   void delete_node(const Node_Ref& node_to_remove)
   {
-    auto& node_vector            = nodes[node_to_remove->level()][node_to_remove->type()];
+    // Detach from parent block so it no longer holds the node as a child or its edges
+    if (node_to_remove->has_parent()) node_to_remove->parent()->remove_child(&*node_to_remove);
+
+    Node* node                   = &*node_to_remove;
+    const int level              = node->level();
+    const int type               = node->type();
+    auto& node_vector            = nodes[level][type];
+    auto& pool                   = block_pool[std::make_pair(level, type)];
+    count_node(level, type, -1);
+
+    // Set empty blocks aside for add_block_node() to reuse rather than freeing
+    if (level > 0 && node->is_empty() && pool.size() < BLOCK_POOL_SIZE) {
+      const auto node_it = std::find_if(node_vector.begin(), node_vector.end(),
+                                        [node](const Node_UPtr& n) { return n.get() == node; });
+      if (node_it == node_vector.end()) LOGIC_ERROR("Tried to delete a node that doesn't exist");
+
+      node->track_emptiness(nullptr);
+      node->remove_parent();
+      pool.push_back(std::move(*node_it));
+      node_vector.erase(node_it);
+      return;
+    }
+
     const bool delete_successful = delete_from_vector(node_vector, node_to_remove);
 
     if (!delete_successful)
       LOGIC_ERROR("Tried to delete a node that doesn't exist");
   }
 
+  bool types_connect(const int type_a, const int type_b) const
+  {
+    return type_adjacency[type_a * n_types() + type_b];
+  }
+
+  // Add amount to the neighbor block totals of every type that can connect to
+  // nodes of type at level
+  void count_node(const int level, const int type, const int amount)
+  {
+    std::vector<int>& totals = neighbor_block_totals[level];
+    for (int t = 0; t < n_types(); t++) {
+      if (types_connect(t, type)) totals[t] += amount;
+    }
+  }
+
+  // Rebuild neighbor block totals after the type adjacency changes
+  void recount_nodes()
+  {
+    for (int level = 0; level < n_levels(); level++) {
+      neighbor_block_totals[level].assign(n_types(), 0);
+      for (int type = 0; type < n_types(); type++) count_node(level, type, nodes[level][type].size());
+    }
+  }
+
+  public:
+  // New empty block, reusing a deleted one when available
   Node* add_block_node(const int type_index, const int level = 1)
   {
-    return add_node("bl_" + types[type_index] + "_" + as_str(block_counter), type_index, level);
+    auto& pool = block_pool[std::make_pair(level, type_index)];
+    if (pool.empty()) return add_node("bl_" + types[type_index] + "_" + as_str(block_counter), type_index, level);
+
+    // Reuse a previously deleted block, its id is free again
+    check_for_level(level);
+    if (node_level_has_blocks(level)) {
+      LOGIC_ERROR("Can't add a node to a network with block structure. This invalidates the model state. Remove block structure with reset_blocks() method.");
+    }
+
+    Node_UPtr block = std::move(pool.back());
+    pool.pop_back();
+
+    Node* block_ptr = block.get();
+    block_ptr->track_emptiness(&empty_blocks[std::make_pair(level, type_index)]);
+    nodes[level][type_index].push_back(std::move(block));
+    count_node(level, type_index, 1);
+    return block_ptr;
+  }
+
+  private:
+  // Block a data node joining a fitted model starts out in
+  Node* starting_block(const int type_index)
+  {
+    const Node_UPtr_Vec& blocks_of_type = get_nodes_of_type(type_index, 1);
+    if (!blocks_of_type.empty()) return sampler.sample(blocks_of_type).get();
+
+    // A new block can only be made when nothing sits above it
+    if (node_level_has_blocks(1)) {
+      LOGIC_ERROR("Model has no blocks of type " + types[type_index]
+                  + " to add the node to. Remove block structure with reset_blocks() method.");
+    }
+    return add_block_node(type_index, 1);
   }
 
   void validate_edge(const int type_a, const int type_b, const bool loading = false)
@@ -407,12 +798,14 @@ class SBM {
 
     if (loading || edge_types == multipartite) {
       // Load the type into connection types for later use
-      connection_types[type_a].insert(type_b);
-      connection_types[type_b].insert(type_a);
+      if (types_connect(type_a, type_b)) return;
+      type_adjacency[type_a * n_types() + type_b] = true;
+      type_adjacency[type_b * n_types() + type_a] = true;
+      recount_nodes();
     } else {
       // If we're in a restricted multipartite network
       // make sure that this is an acceptable edgetype combo
-      const bool edge_not_allowed = connection_types[type_a].count(type_b) == 0;
+      const bool edge_not_allowed = !types_connect(type_a, type_b);
 
       if (edge_not_allowed)
         LOGIC_ERROR("Connection provided between nodes of types "
@@ -436,28 +829,49 @@ class SBM {
     add_node(to_str(id), get_type_index(to_str(type)), level);
   }
 
-  void add_edge(const string& node_a, const string& node_b)
+  // Weight is the number of edges between the two nodes. Repeated edges are
+  // stored once with their combined weight.
+  void add_edge(const string& node_a, const string& node_b, const int weight = 1)
+  {
+    add_edge_between(get_node_by_id(node_a), get_node_by_id(node_b), weight);
+  }
+
+  // Same as add_edge() for callers already holding the nodes
+  void add_edge_between(Node* a, Node* b, const int weight = 1)
   {
-    Node* a = get_node_by_id(node_a);
-    Node* b = get_node_by_id(node_b);
+    if (weight < 1) LOGIC_ERROR("Edge weights must be positive integers");
+
+    validate_edge(a->type(), b->type());
+
+    // Blocks above the two nodes count the edge as it's added
+    connect_nodes(a, b, weight);
 
     if (node_level_has_blocks(0)) {
-      LOGIC_ERROR("Block structure present in network. Adding an edge invalidates the model state. Remove block structure with reset_blocks() method.");
+      changed_nodes.push_back(a);
+      changed_nodes.push_back(b);
     }
 
-    validate_edge(a->type(), b->type());
+    _n_edges += weight;
 
-    a->add_neighbor(b);
-    b->add_neighbor(a);
+    // No degree or edge count in the model can exceed 2E
+    reserve_log_tables(2 * _n_edges);
+  }
 
-    _n_edges++;
+  void add_edge_unweighted(const string& node_a, const string& node_b)
+  {
+    add_edge(node_a, node_b, 1);
   }
 
+  // Weights are optional, every edge gets a weight of one when empty
   void add_edges(const InOut_String_Vec& edges_a,
                  const InOut_String_Vec& edges_b,
                  const InOut_String_Vec& allowed_edges_a = {},
-                 const InOut_String_Vec& allowed_edges_b = {})
+                 const InOut_String_Vec& allowed_edges_b = {},
+                 const InOut_Int_Vec& weights            = {})
   {
+    const bool has_weights = weights.size() != 0;
+    if (has_weights && weights.size() != edges_a.size()) LOGIC_ERROR("Need one weight per edge");
+
     // We have restricted multipartite structure if allowed edges are not empty
     if (allowed_edges_a.size() != 0) {
       // Set partite structure to reflect
@@ -473,12 +887,108 @@ class SBM {
 
     // Connect nodes with edges
     for (int i = 0; i < edges_a.size(); i++) add_edge(to_str(edges_a[i]),
-                                                      to_str(edges_b[i]));
+                                                      to_str(edges_b[i]),
+                                                      has_weights ? weights[i] : 1);
+  }
+
+  // Rebuilds the data nodes so that nodes close together in the chosen order
+  // sit close together in memory and each node's neighbor list runs in that
+  // order too. "rcm" is reverse Cuthill-McKee, a breadth first order that
+  // keeps neighbors near each other. "degree" puts the busiest nodes first.
+  // Sweeps then shuffle nodes within runs of sweep_chunk_size instead of all
+  // at once so consecutive moves touch nearby memory. Ids and the order of
+  // data_node_ids() are unchanged.
+  void reorder_nodes(const string& order, const int sweep_chunk_size)
+  {
+    if (node_level_has_blocks(0)) {
+      LOGIC_ERROR("Can't reorder nodes in a network with block structure. Remove block structure with reset_blocks() method.");
+    }
+    if (sweep_chunk_size < 1) LOGIC_ERROR("Sweep chunk size must be at least 1");
+
+    const Node_Vec ordered = order_data_nodes(order);
+    const int n            = ordered.size();
+
+    Flat_Hash_Map<const Node*, int> rank;
+    rank.reserve(n);
+    for (int i = 0; i < n; i++) rank.emplace(ordered[i], i);
+
+    // Allocate the new nodes back to back in their new order
+    Type_Vec new_level(n_types());
+    Node_Vec new_nodes(n);
+    for (int i = 0; i < n; i++) {
+      auto node = Node_UPtr(new Node(ordered[i]->id(), 0, ordered[i]->type(), ++node_serial));
+      new_nodes[i] = node.get();
+      new_level[node->type()].push_back(std::move(node));
+    }
+
+    // Copy edges over with each neighbor list in rank order. Lists are
+    // already free of repeats so entries go straight on the end. Self edge
+    // entries already hold both ends so they copy as is.
+    std::vector<std::pair<int, int>> neighbors;
+    for (int i = 0; i < n; i++) {
+      neighbors.clear();
+      for (const auto& neighbor : ordered[i]->neighbors()) neighbors.emplace_back(rank.at(neighbor.node), neighbor.weight);
+      std::sort(neighbors.begin(), neighbors.end());
+      for (const auto& neighbor : neighbors) new_nodes[i]->add_new_neighbor(new_nodes[neighbor.first], neighbor.second);
+    }
+
+    for (auto& node : data_nodes) node = new_nodes[rank.at(node)];
+    for (const auto& node : new_nodes) id_to_node[node->id()] = node;
+
+    nodes[0]               = std::move(new_level);
+    node_order             = order;
+    locality_order         = std::move(new_nodes);
+    this->sweep_chunk_size = sweep_chunk_size;
+  }
+
+  private:
+  Node_Vec order_data_nodes(const string& order) const
+  {
+    Node_Vec ordered = data_nodes;
+    const auto by_degree = [](const Node* a, const Node* b) { return a->degree() < b->degree(); };
+
+    if (order == "degree") {
+      std::stable_sort(ordered.begin(), ordered.end(), [](const Node* a, const Node* b) { return a->degree() > b->degree(); });
+      return ordered;
+    }
+
+    if (order != "rcm") LOGIC_ERROR("Unknown node order " + order + ". Options are rcm and degree.");
+
+    // Breadth first from the lowest degree node left in each component,
+    // queueing neighbors from lowest degree up, then reversed
+    std::stable_sort(ordered.begin(), ordered.end(), by_degree);
+
+    Flat_Hash_Set<const Node*> visited;
+    visited.reserve(ordered.size());
+    Node_Vec bfs_order;
+    bfs_order.reserve(ordered.size());
+    Node_Vec next;
+
+    for (Node* start : ordered) {
+      if (!visited.insert(start).second) continue;
+
+      bfs_order.push_back(start);
+
+      // The tail of bfs_order doubles as the queue
+      for (int head = bfs_order.size() - 1; head < bfs_order.size(); head++) {
+        next.clear();
+        for (const auto& neighbor : bfs_order[head]->neighbors()) {
+          if (visited.insert(neighbor.node).second) next.push_back(neighbor.node);
+        }
+        std::stable_sort(next.begin(), next.end(), by_degree);
+        bfs_order.insert(bfs_order.end(), next.begin(), next.end());
+      }
+    }
+
+    std::reverse(bfs_order.begin(), bfs_order.end());
+    return bfs_order;
   }
 
+  public:
   void build_block_level(const int reserve_size = 0)
   {
     nodes.emplace_back(n_types());
+    neighbor_block_totals.emplace_back(n_types(), 0);
 
     // If we were told to reserve a size for each type vec, do so.
     if (reserve_size > 0) {
@@ -566,6 +1076,23 @@ class SBM {
     for (int i = 0; i < n_levels_to_remove; i++) {
       // Remove the last layer of nodes.
       nodes.pop_back();
+      neighbor_block_totals.pop_back();
+    }
+
+    // Pooled blocks of the dropped levels would come back with ids that new
+    // blocks are given again once block_counter restarts
+    for (auto pool_it = block_pool.begin(); pool_it != block_pool.end();) {
+      if (pool_it->first.first > last_level_index) {
+        pool_it = block_pool.erase(pool_it);
+      } else {
+        ++pool_it;
+      }
+    }
+
+    // Nothing is left to place data nodes into
+    if (last_level_index == 0) {
+      unplaced_nodes.clear();
+      changed_nodes.clear();
     }
   }
 
@@ -582,24 +1109,142 @@ class SBM {
     child_node->set_parent(new_block);
 
     // If the old block is now empty and we're removing empty blocks, delete it
-    if (has_old_block && remove_empty && old_block->is_empty()) {
-      auto& block_vector           = nodes[old_block->level()][old_block->type()];
-      const bool delete_successful = delete_from_vector(block_vector, old_block);
+    if (has_old_block && remove_empty && old_block->is_empty()) delete_node(old_block);
+  }
+
+  // Deletes all blocks at a level without any children. Returns number removed.
+  int remove_empty_blocks(const int level)
+  {
+    check_for_level(level);
 
-      if (!delete_successful)
-        LOGIC_ERROR("Tried to delete a node that doesn't exist");
+    int n_removed = 0;
+    for (int type = 0; type < n_types(); type++) {
+      // Deleting takes the block off the list
+      const Node_Vec& empty_of_type = empty_blocks_of_type(type, level);
+      for (; !empty_of_type.empty(); n_removed++) delete_node(empty_of_type.back());
     }
+
+    return n_removed;
   }
 
-  Node* propose_move(Node* node, const int to_level, const double eps = 0.1)
+  // Agglomeratively merges the blocks above node_level until there are B_end
+  // left, optionally letting nodes settle with MCMC sweeps after each step.
+  // The results of each merge step are passed to on_step.
+  template <typename Step_Fn>
+  void merge_down_to(const int node_level,
+                     const int B_end,
+                     const int n_checks_per_block,
+                     const int n_mcmc_sweeps,
+                     const double& sigma,
+                     const double& eps,
+                     const bool allow_exhaustive,
+                     Step_Fn on_step)
+  {
+    const int block_level = node_level + 1;
+    const bool using_mcmc = n_mcmc_sweeps > 0;
+
+    // Setup variable to track the current number of blocks in the model
+    int B_cur = n_nodes_at_level(block_level);
+
+    // Lambda to calculate how many merges a step needs
+    auto calc_num_merges = [&B_end, &sigma](const int B) {
+      // How many blocks the sigma hueristic wants network to have after next move
+      // max of this value and target is taken to avoid overshooting goal
+      const int B_next = std::max(int(std::floor(double(B) / sigma)),
+                                  B_end);
+
+      return std::max(B - B_next, 1);
+    };
+
+    // Keep doing merges until we've reached the desired number of blocks
+    while (B_cur > B_end && !stop_requested()) {
+      const int n_merges_to_make = calc_num_merges(B_cur);
+
+      // Perform merges
+      auto merge_result = agglomerative_merge(this,
+                                              block_level,
+                                              n_merges_to_make,
+                                              n_checks_per_block,
+                                              eps,
+                                              allow_exhaustive);
+
+      // Warnings go through R so background jobs stay quiet
+      if (merge_result.ran_out_of_merges && interruptible) {
+        WARN_ABOUT("Ran of merges during agglomerative merging step. Try raising num_block_proposals and/or lowering sigma.");
+      }
+
+      // Update B_cur
+      B_cur -= merge_result.n_merges_made();
+
+      if (using_mcmc) {
+        // Update the merge results entropy delta with the changes caused by MCMC sweep
+        merge_result.entropy_delta += mcmc_sweep_at_temp(n_mcmc_sweeps,
+                                                         eps,        // eps
+                                                         false,      // variable num blocks
+                                                         false,      // track pairs
+                                                         node_level, // level
+                                                         false,      // verbose
+                                                         1.0)        // beta
+                                          .entropy_delta;
+
+        // Remove any blocks emptied by our MCMC sweep and account for them in block count
+        B_cur -= remove_empty_blocks(block_level);
+      }
+
+      // Add info on how many blocks are remaining to merge info
+      merge_result.n_blocks = B_cur;
+
+      on_step(merge_result);
+    }
+  }
+
+  private:
+  // Block counts key on const pointers but every block belongs to this model
+  Node* block_at_level(const Node* node, const int level) const
+  {
+    return node->level() == level ? const_cast<Node*>(node) : node->parent_at_level(level);
+  }
+
+  // Block at level on the other end of the edge of node picked by draw. Data
+  // nodes walk their weighted neighbors, blocks their block edge counts.
+  Node* sample_neighbor_block(const Node* node, const int level, const double draw)
+  {
+    int edge_i = Sampler::unif_to_int(draw, node->degree() - 1);
+
+    if (node->level() == 0) {
+      for (const auto& neighbor : node->neighbors()) {
+        if (edge_i < neighbor.weight) return neighbor.node->parent_at_level(level);
+        edge_i -= neighbor.weight;
+      }
+    } else {
+      for (const auto& block_count : node->block_edges()) {
+        if (edge_i < block_count.second) return block_at_level(block_count.first, level);
+        edge_i -= block_count.second;
+      }
+    }
+    LOGIC_ERROR("Node's degree doesn't match its edges");
+  }
+
+  public:
+  // Proposal compiled for a given type layout. With a single neighbor type
+  // every edge of the neighbor block leads back to the node's type. Random
+  // choices are read from draws, laid out as in Move_Draw.
+  template <Type_Layout Layout>
+  Node* propose_move(Node* node, const int to_level, const double eps, const double* draws)
   {
     // Sample a random neighbor block
-    Node* neighbor_block = sampler.sample(node->neighbors(),
-                                          node->degree())
-                               ->parent();
+    const Node* neighbor_block = sample_neighbor_block(node, to_level, draws[neighbor_edge_draw]);
 
-    // Get all the nodes connected to neighbor block of the node-to-move's type
-    const Node_Ptr_Vec& neighbor_edges_to_t = neighbor_block->neighbors_of_type(node->type());
+    // Count neighbor block's edges to blocks of the node-to-move's type
+    const int node_type = node->type();
+    int n_edges_to_t    = 0;
+    if (Layout == single_neighbor_type) {
+      n_edges_to_t = neighbor_block->degree();
+    } else {
+      for (const auto& block_count : neighbor_block->block_edges()) {
+        if (block_count.first->type() == node_type) n_edges_to_t += block_count.second;
+      }
+    }
 
     // Get a reference to all the blocks that the node-to-move _could_ join
     const Node_UPtr_Vec& all_potential_blocks = get_nodes_of_type(node->type(), to_level);
@@ -607,46 +1252,421 @@ class SBM {
     // Decide if we are going to choose a random block for our node
     const double ergo_amnt = eps * all_potential_blocks.size();
 
-    const bool draw_from_neighbor = sampler.draw_unif()
-        > ergo_amnt / (double(neighbor_edges_to_t.size()) + ergo_amnt);
+    const bool draw_from_neighbor = draws[random_block_draw]
+        > ergo_amnt / (double(n_edges_to_t) + ergo_amnt);
 
     // Decide where we will get new block from and draw from potential candidates
     if (draw_from_neighbor) {
-      return sampler.sample(neighbor_edges_to_t)->parent_at_level(to_level);
+      // Follow a random one of those edges
+      int edge_i = Sampler::unif_to_int(draws[block_draw], n_edges_to_t - 1);
+      for (const auto& block_count : neighbor_block->block_edges()) {
+        if (Layout == mixed_neighbor_types && block_count.first->type() != node_type) continue;
+        if (edge_i < block_count.second) return block_at_level(block_count.first, to_level);
+        edge_i -= block_count.second;
+      }
+      LOGIC_ERROR("Block edge counts don't match their totals");
     } else {
-      return sampler.sample(all_potential_blocks).get();
+      return all_potential_blocks[Sampler::unif_to_int(draws[block_draw], all_potential_blocks.size() - 1)].get();
     }
   }
 
-  // Default proposal that returns a potential new parent block
-  Node* propose_move(Node* node, const double eps = 0.1)
+  // Same proposal for node i of a partition's arrays, with block edge counts
+  // read from dense_counts over the partition's blocks. Returns the index of
+  // the proposed block.
+  template <Type_Layout Layout>
+  int propose_move(const Partition_Arrays& partition,
+                   const Dense_Block_Counts& dense_counts,
+                   const int i,
+                   const double eps,
+                   const double* draws) const
   {
-    return propose_move(node, node->level() + 1, eps);
+    const int neighbor_block = partition.sample_neighbor_block(i, draws[neighbor_edge_draw]);
+    const int* neighbor_row  = dense_counts.counts_row(neighbor_block);
+    const int n_blocks       = partition.n_blocks();
+
+    const int node_type = partition.type[i];
+    int n_edges_to_t    = 0;
+    if (Layout == single_neighbor_type) {
+      n_edges_to_t = partition.block_degree[neighbor_block];
+    } else {
+      for (int t = 0; t < n_blocks; t++) {
+        if (partition.block_type[t] == node_type) n_edges_to_t += neighbor_row[t];
+      }
+    }
+
+    const std::vector<int>& potential_blocks = partition.blocks_of_type[node_type];
+    const double ergo_amnt                   = eps * potential_blocks.size();
+
+    const bool draw_from_neighbor = draws[random_block_draw]
+        > ergo_amnt / (double(n_edges_to_t) + ergo_amnt);
+
+    if (draw_from_neighbor) {
+      int edge_i = Sampler::unif_to_int(draws[block_draw], n_edges_to_t - 1);
+      for (int t = 0; t < n_blocks; t++) {
+        if (Layout == mixed_neighbor_types && partition.block_type[t] != node_type) continue;
+        if (edge_i < neighbor_row[t]) return t;
+        edge_i -= neighbor_row[t];
+      }
+      LOGIC_ERROR("Block edge counts don't match their totals");
+    } else {
+      return potential_blocks[Sampler::unif_to_int(draws[block_draw], potential_blocks.size() - 1)];
+    }
   }
 
-  // Propose a merger with another node
-  Node* propose_merge(Node* node, const double eps = 0.1)
+  // Same proposal with fresh draws from the model's sampler
+  template <Type_Layout Layout>
+  Node* propose_move(Node* node, const int to_level, const double eps)
   {
-    return propose_move(node, node->level(), eps);
+    double draws[n_move_draws];
+    sampler.fill_unif(draws, n_move_draws);
+    return propose_move<Layout>(node, to_level, eps, draws);
   }
 
+  Node* propose_move(Node* node, const int to_level, const double eps = 0.1)
+  {
+    return type_layout() == single_neighbor_type
+        ? propose_move<single_neighbor_type>(node, to_level, eps)
+        : propose_move<mixed_neighbor_types>(node, to_level, eps);
+  }
+
+  // Default proposal that returns a potential new parent block
+  Node* propose_move(Node* node, const double eps = 0.1)
+  {
+    return propose_move(node, node->level() + 1, eps);
+  }
+
+  // Propose a merger with another node
+  Node* propose_merge(Node* node, const double eps = 0.1)
+  {
+    return propose_move(node, node->level(), eps);
+  }
+
+  // Heat-bath move: draw node's new block from the exact conditional over
+  // every block of its type, p(s) ~ exp(-beta * entropy_delta(s)). This
+  // includes the node's current block and, when the number of blocks can
+  // vary, the empty block. Draws are always accepted so results for the
+  // chosen block are returned with an acceptance probability of one.
+  Node* heat_bath_draw(Node* node,
+                       const double eps,
+                       const double beta,
+                       Move_Results& drawn_results)
+  {
+    const auto& blocks_of_type = get_nodes_of_type(node->type(), node->level() + 1);
+
+    Node_Vec candidates;
+    candidates.reserve(blocks_of_type.size());
+    for (const auto& block : blocks_of_type) candidates.push_back(block.get());
+
+    const auto scores = get_move_results(node, candidates, n_possible_neighbor_blocks(node), eps, beta);
+    return candidates[draw_from_scores(scores, beta, drawn_results)];
+  }
+
+  // Same draw for node i of a partition's arrays with scores from the dense
+  // counts of its blocks. Returns the index of the drawn block.
+  int heat_bath_draw(const Partition_Arrays& partition,
+                     Dense_Block_Counts& dense_counts,
+                     const int i,
+                     const int n_possible,
+                     const double eps,
+                     const double beta,
+                     Move_Results& drawn_results)
+  {
+    const std::vector<int>& candidates = partition.blocks_of_type[partition.type[i]];
+
+    std::vector<Move_Results> scores;
+    scores.reserve(candidates.size());
+    for (const int s : candidates) scores.push_back(dense_counts.move_results(partition, i, s, n_possible, eps, beta));
+
+    return candidates[draw_from_scores(scores, beta, drawn_results)];
+  }
+
+  private:
+  // Index of a draw from scores weighted by exp(-beta * entropy_delta). The
+  // drawn results are always accepted.
+  int draw_from_scores(const std::vector<Move_Results>& scores,
+                       const double beta,
+                       Move_Results& drawn_results)
+  {
+    // Shift by the smallest delta so the best block has a weight of one
+    double min_delta = 0.0; // Staying put is always a candidate
+    for (const auto& score : scores) min_delta = std::min(min_delta, score.entropy_delta);
+
+    std::vector<double> weights(scores.size());
+    double total_weight = 0.0;
+    for (int i = 0; i < scores.size(); i++) {
+      weights[i] = std::exp(-beta * (scores[i].entropy_delta - min_delta));
+      total_weight += weights[i];
+    }
+
+    double draw  = sampler.draw_unif() * total_weight;
+    int chosen_i = 0;
+    for (; chosen_i < weights.size() - 1; chosen_i++) {
+      draw -= weights[chosen_i];
+      if (draw < 0) break;
+    }
+
+    drawn_results                = scores[chosen_i];
+    drawn_results.prob_ratio     = 1.0;
+    drawn_results.prob_of_accept = 1.0;
+    return chosen_i;
+  }
+
+  public:
+  // =========================================================================
+  // Merge-split moves
+  // =========================================================================
+  // Picks two random nodes of the same type at level. If they share a block
+  // that block is proposed to be split with one node anchoring each half,
+  // otherwise their two blocks are proposed to be merged. Split halves are
+  // drawn with a restricted Gibbs sampler between the two blocks (Jain & Neal,
+  // 2004) whose probability of making the split goes into the acceptance
+  // ratio of both directions. Needs the empty block for the node's type that
+  // variable block sweeps keep around. Returns the entropy delta of the move
+  // (0 if rejected) and fills moved_nodes with nodes that changed blocks.
+  double merge_split_move(const int level,
+                          const double beta,
+                          Node_Vec& moved_nodes,
+                          Pair_Set* pair_moves = nullptr)
+  {
+    moved_nodes.clear();
+
+    Node* node_i        = sampler.sample(get_nodes_at_level(level), n_nodes_at_level(level)).get();
+    const auto& of_type = get_nodes_of_type(node_i->type(), level);
+    if (of_type.size() < 2) return 0.0;
+
+    Node* node_j = node_i;
+    while (node_j == node_i) node_j = sampler.sample(of_type).get();
+
+    Node* block_i = node_i->parent();
+    Node* block_j = node_j->parent();
+
+    return block_i == block_j
+        ? propose_split(node_i, node_j, beta, moved_nodes, pair_moves)
+        : propose_merge_blocks(node_i, node_j, beta, moved_nodes, pair_moves);
+  }
+
+  private:
+  // Number of restricted Gibbs scans between launch and the final scan whose
+  // probability gets used in the acceptance ratio
+  static const int N_RESTRICTED_SCANS = 3;
+
+  // log(1 + exp(x)) without overflow
+  static double log_one_plus_exp(const double x)
+  {
+    return x > 0 ? x + std::log1p(std::exp(-x)) : std::log1p(std::exp(x));
+  }
+
+  // One pass of restricted Gibbs over scan_nodes, each of which is in block_a
+  // or block_b and can only move between the two. Nodes go to forced_blocks
+  // (same order as scan_nodes) if given and get drawn otherwise. Returns log
+  // probability of the assignments made; entropy change is added to
+  // entropy_delta.
+  double restricted_gibbs_scan(const Node_Vec& scan_nodes,
+                               Node* block_a,
+                               Node* block_b,
+                               const double beta,
+                               double& entropy_delta,
+                               const Node_Vec* forced_blocks = nullptr)
+  {
+    double log_prob = 0.0;
+    for (int k = 0; k < scan_nodes.size(); k++) {
+      Node* node       = scan_nodes[k];
+      Node* other      = node->parent() == block_a ? block_b : block_a;
+      const double d_s = get_move_results(node, other, 1).entropy_delta;
+
+      // P(move) = 1 / (1 + exp(beta * d_s)), P(stay) = 1 / (1 + exp(-beta * d_s))
+      const double log_p_move = -log_one_plus_exp(beta * d_s);
+      const double log_p_stay = -log_one_plus_exp(-beta * d_s);
+
+      const bool move = forced_blocks
+          ? (*forced_blocks)[k] == other
+          : sampler.draw_unif() < std::exp(log_p_move);
+
+      log_prob += move ? log_p_move : log_p_stay;
+      if (move) {
+        node->set_parent(other);
+        entropy_delta += d_s;
+      }
+    }
+    return log_prob;
+  }
+
+  // Random launch state followed by the intermediate restricted scans.
+  // Returns entropy change.
+  double restricted_gibbs_launch(const Node_Vec& scan_nodes, Node* block_a, Node* block_b, const double beta)
+  {
+    double entropy_delta = 0.0;
+    for (Node* node : scan_nodes) {
+      Node* launch_block = sampler.draw_unif() < 0.5 ? block_a : block_b;
+      if (launch_block == node->parent()) continue;
+      entropy_delta += get_move_results(node, launch_block, 1).entropy_delta;
+      node->set_parent(launch_block);
+    }
+    for (int scan = 0; scan < N_RESTRICTED_SCANS; scan++) {
+      restricted_gibbs_scan(scan_nodes, block_a, block_b, beta, entropy_delta);
+    }
+    return entropy_delta;
+  }
+
+  Node* empty_block_of_type(const int type, const int level)
+  {
+    const Node_Vec& empty_of_type = empty_blocks_of_type(type, level);
+    if (empty_of_type.empty()) LOGIC_ERROR("No empty block of type " + types[type] + " to split into");
+    return empty_of_type.back();
+  }
+
+  double propose_split(Node* node_i,
+                       Node* node_j,
+                       const double beta,
+                       Node_Vec& moved_nodes,
+                       Pair_Set* pair_moves)
+  {
+    Node* block     = node_i->parent();
+    Node* new_block = empty_block_of_type(node_j->type(), block->level());
+
+    Node_Vec scan_nodes;
+    scan_nodes.reserve(block->n_children());
+    for (Node* child : block->children()) {
+      if (child != node_i && child != node_j) scan_nodes.push_back(child);
+    }
+
+    double entropy_delta = get_move_results(node_j, new_block, 1).entropy_delta;
+    node_j->set_parent(new_block);
+
+    entropy_delta += restricted_gibbs_launch(scan_nodes, block, new_block, beta);
+    const double log_q_split = restricted_gibbs_scan(scan_nodes, block, new_block, beta, entropy_delta);
+
+    // Reverse merge is certain once the same pair of nodes is picked
+    const bool accepted = std::log(sampler.draw_unif()) < -beta * entropy_delta - log_q_split;
+
+    if (!accepted) {
+      for (Node* child : Node_Vec(new_block->children())) child->set_parent(block);
+      return 0.0;
+    }
+
+    moved_nodes = new_block->children();
+    if (pair_moves) {
+      for (const Node* moved : moved_nodes) {
+        Block_Consensus::update_changed_pairs(moved->id(), block->children(), {}, *pair_moves);
+      }
+    }
+
+    // Keep an empty block around for the next split or single node move
+    add_block_node(node_j->type(), block->level());
+    return entropy_delta;
+  }
+
+  double propose_merge_blocks(Node* node_i,
+                              Node* node_j,
+                              const double beta,
+                              Node_Vec& moved_nodes,
+                              Pair_Set* pair_moves)
+  {
+    Node* block_i = node_i->parent();
+    Node* block_j = node_j->parent();
+
+    Node_Vec scan_nodes;
+    Node_Vec current_blocks;
+    for (Node* block : { block_i, block_j }) {
+      for (Node* child : block->children()) {
+        if (child == node_i || child == node_j) continue;
+        scan_nodes.push_back(child);
+        current_blocks.push_back(block);
+      }
+    }
+
+    // Probability the reverse split would recreate the current two blocks.
+    // The forced final scan leaves the network exactly as it started.
+    double scan_entropy_delta = restricted_gibbs_launch(scan_nodes, block_i, block_j, beta);
+    const double log_q_split  = restricted_gibbs_scan(scan_nodes, block_i, block_j, beta, scan_entropy_delta, &current_blocks);
+
+    const double entropy_delta = merge_entropy_delta(Node_Pair(block_i, block_j));
+    const bool accepted        = std::log(sampler.draw_unif()) < -beta * entropy_delta + log_q_split;
+
+    if (!accepted) return 0.0;
+
+    moved_nodes = block_j->children();
+    if (pair_moves) {
+      for (const Node* moved : moved_nodes) {
+        Block_Consensus::update_changed_pairs(moved->id(), {}, block_i->children(), *pair_moves);
+      }
+    }
+
+    merge_blocks(block_j, block_i);
+    return entropy_delta;
+  }
+
+  public:
+  // Checkpoints are written if set_checkpoint() has been called
   MCMC_Sweeps mcmc_sweep(const int n_sweeps,
                          const double& eps,
                          const bool variable_num_blocks,
                          const bool track_pairs,
-                         const int level    = 0,
-                         const bool verbose = false)
+                         const int level      = 0,
+                         const bool verbose   = false,
+                         const bool heat_bath = false)
+  {
+    return sweep_with_layout(n_sweeps, eps, variable_num_blocks, track_pairs, level, verbose, 1.0, heat_bath, checkpoint_every > 0);
+  }
+
+  // Runs sweeps targeting the posterior raised to the power beta (inverse
+  // temperature). beta = 1 is the standard sampler, beta < 1 flattens the
+  // posterior so the chain can escape local modes more easily. With heat_bath
+  // nodes draw their new block from the exact conditional instead of going
+  // through a Metropolis-Hastings proposal and accept step.
+  MCMC_Sweeps mcmc_sweep_at_temp(const int n_sweeps,
+                                 const double& eps,
+                                 const bool variable_num_blocks,
+                                 const bool track_pairs,
+                                 const int level,
+                                 const bool verbose,
+                                 const double& beta,
+                                 const bool heat_bath = false)
+  {
+    return sweep_with_layout(n_sweeps, eps, variable_num_blocks, track_pairs, level, verbose, beta, heat_bath, false);
+  }
+
+  private:
+  MCMC_Sweeps sweep_with_layout(const int n_sweeps,
+                                const double& eps,
+                                const bool variable_num_blocks,
+                                const bool track_pairs,
+                                const int level,
+                                const bool verbose,
+                                const double& beta,
+                                const bool heat_bath,
+                                const bool checkpointed,
+                                Sweep_Resume* resume = nullptr)
+  {
+    return type_layout() == single_neighbor_type
+        ? run_sweeps<single_neighbor_type>(n_sweeps, eps, variable_num_blocks, track_pairs, level, verbose, beta, heat_bath, checkpointed, resume)
+        : run_sweeps<mixed_neighbor_types>(n_sweeps, eps, variable_num_blocks, track_pairs, level, verbose, beta, heat_bath, checkpointed, resume);
+  }
+
+  // A resumed run starts from the state its checkpoint restored, which
+  // already has any empty blocks and pair tracking in place
+  template <Type_Layout Layout>
+  MCMC_Sweeps run_sweeps(const int n_sweeps,
+                         const double& eps,
+                         const bool variable_num_blocks,
+                         const bool track_pairs,
+                         const int level,
+                         const bool verbose,
+                         const double& beta,
+                         const bool heat_bath,
+                         const bool checkpointed,
+                         Sweep_Resume* resume)
   {
     const int block_level = level + 1;
 
     // Initialize structure that contains the returned values for this/these sweeps
-    MCMC_Sweeps results(n_sweeps);
+    MCMC_Sweeps results = resume ? std::move(resume->results) : MCMC_Sweeps(n_sweeps);
 
     // Initialize pair tracking map if needed
-    if (track_pairs) results.block_consensus.initialize(get_nodes_at_level(level));
+    if (track_pairs && !resume) results.block_consensus.initialize(get_nodes_at_level(level));
 
     // Check if we have any blocks ready in the network...
-    const bool no_blocks_present = n_levels() > block_level + 1;
+    const bool no_blocks_present = n_levels() < block_level + 1;
 
     if (no_blocks_present) {
       initialize_blocks();
@@ -654,8 +1674,17 @@ class SBM {
       if (verbose) WARN_ABOUT("No blocks present. Initializing one block per node.");
     }
 
+    // Background sweep jobs report entropy as they go
+    if (job_control && job_control->kind == sweep_job) job_control->set_entropy(entropy(level));
+
+    // New blocks would have no parent so they can't be made inside a hierarchy
+    if (variable_num_blocks && node_level_has_blocks(block_level)) {
+      LOGIC_ERROR("Can't vary number of blocks at level " + as_str(block_level)
+                  + " as it has blocks of its own. Use a fixed number of blocks.");
+    }
+
     // If allowing a variable number of blocks, initialize empty block for each type
-    if (variable_num_blocks) {
+    if (variable_num_blocks && !resume) {
       for (int type = 0; type < n_types(); type++) {
         add_block_node(type, block_level);
       }
@@ -670,15 +1699,45 @@ class SBM {
                          << "move_accepted" << std::endl;
 
     // Initialize a vector of nodes that will be passed through for a sweep.
-    auto nodes = get_flat_level(level);
+    auto nodes = resume ? resume->order : get_flat_level(level);
+
+    // Uniform draws for the whole sweep, n_move_draws per node in sweep order
+    std::vector<double> sweep_draws;
+
+    // Data nodes laid out by reorder_nodes() are swept a run at a time
+    const bool chunked_sweep = level == 0 && sweep_chunk_size > 1 && locality_order.size() == nodes.size();
+
+    // With a small, fixed set of blocks move deltas are read from a dense
+    // count matrix that gets kept current as moves are accepted. Proposals and
+    // scoring then read nodes from flat partition arrays and accepted moves
+    // reach the Node objects once per sweep.
+    const bool use_dense = !variable_num_blocks
+        && n_nodes_at_level(block_level) <= DENSE_BLOCK_THRESHOLD;
+    Partition_Arrays partition = use_dense
+        ? Partition_Arrays(get_flat_level(level), get_flat_level(block_level), n_types())
+        : Partition_Arrays();
+    Dense_Block_Counts dense_counts = use_dense
+        ? Dense_Block_Counts(partition.blocks())
+        : Dense_Block_Counts();
+
+    std::vector<int> n_possible_of_type(n_types());
+    for (int type = 0; type < n_types(); type++) {
+      n_possible_of_type[type] = n_possible_neighbor_blocks(type, block_level);
+    }
 
-    for (int i = 0; i < n_sweeps; i++) {
+    for (int i = resume ? resume->first_sweep : 0; i < n_sweeps; i++) {
       // Book keeper variables for this sweeps stats
       int n_nodes_moved    = 0;
+      int n_proposed       = 0;
       double entropy_delta = 0;
 
       // Shuffle order of nodes to be run through for sweep
-      sampler.shuffle(nodes);
+      if (chunked_sweep) {
+        sampler.chunk_shuffle(locality_order, nodes, sweep_chunk_size);
+      } else {
+        sampler.shuffle(nodes);
+      }
+      if (!heat_bath) sampler.fill_unif(sweep_draws, n_move_draws * nodes.size());
 
       // Setup container to track what pairs of nodes need to have
       // their consensus membership updated for this sweep
@@ -686,11 +1745,34 @@ class SBM {
 
       int steps_taken = 0;
       // Loop through each node
-      for (const auto& curr_node : nodes) {
-        // Get a move proposal
-        Node* proposed_new_block = propose_move(curr_node, eps);
-
-        Node* old_block = curr_node->parent();
+      for (int node_i = 0; node_i < nodes.size(); node_i++) {
+        Node* curr_node = nodes[node_i];
+        const int array_i = use_dense ? partition.index(curr_node) : -1;
+
+        // Unconnected nodes (or emptied blocks) have no information to move on
+        if ((use_dense ? partition.degree[array_i] : curr_node->degree()) == 0) continue;
+
+        const double* draws = heat_bath ? nullptr : &sweep_draws[n_move_draws * node_i];
+        n_proposed++;
+
+        // Get a move proposal (heat-bath scores its draw as it goes)
+        Move_Results proposal_results(0, 1);
+        Node* proposed_new_block;
+        Node* old_block;
+        int new_block_i = -1;
+        if (use_dense) {
+          const int n_possible = n_possible_of_type[partition.type[array_i]];
+          new_block_i          = heat_bath
+              ? heat_bath_draw(partition, dense_counts, array_i, n_possible, eps, beta, proposal_results)
+              : propose_move<Layout>(partition, dense_counts, array_i, eps, draws);
+          proposed_new_block = partition.block(new_block_i);
+          old_block          = partition.block(partition.block_of[array_i]);
+        } else {
+          proposed_new_block = heat_bath
+              ? heat_bath_draw(curr_node, eps, beta, proposal_results)
+              : propose_move<Layout>(curr_node, block_level, eps, draws);
+          old_block = curr_node->parent();
+        }
 
         // If proposed block is the current block, we don't need to waste
         // time checking because decision will always result in same state.
@@ -698,18 +1780,28 @@ class SBM {
 
         if (verbose) OUT_MSG << i
                              << "," << curr_node->id()
-                             << "," << curr_node->parent()->id()
+                             << "," << old_block->id()
                              << "," << proposed_new_block->id()
                              << ",";
 
         // Calculate acceptance probability based on posterior changes
-        auto proposal_results = get_move_results(curr_node,
-                                                 proposed_new_block,
-                                                 n_possible_neighbor_blocks(curr_node),
-                                                 eps);
+        if (!heat_bath) {
+          proposal_results = use_dense
+              ? dense_counts.move_results(partition,
+                                          array_i,
+                                          new_block_i,
+                                          n_possible_of_type[partition.type[array_i]],
+                                          eps,
+                                          beta)
+              : get_move_results(curr_node,
+                                 proposed_new_block,
+                                 n_possible_neighbor_blocks(curr_node),
+                                 eps,
+                                 beta);
+        }
 
         // Make movement decision
-        const bool move_accepted = proposal_results.prob_of_accept > sampler.draw_unif();
+        const bool move_accepted = heat_bath || proposal_results.prob_of_accept > draws[accept_draw];
 
         if (verbose) OUT_MSG << proposal_results.entropy_delta << ","
                              << proposal_results.prob_of_accept << ","
@@ -737,7 +1829,13 @@ class SBM {
             }
           }
 
-          swap_blocks(curr_node, proposed_new_block, remove_empty_block);
+          if (use_dense) {
+            dense_counts.commit_move(partition, array_i, new_block_i);
+            partition.move(array_i, new_block_i, track_pairs);
+          }
+
+          // Pair tracking reads blocks' children so can't wait for the sync
+          if (!use_dense || track_pairs) swap_blocks(curr_node, proposed_new_block, remove_empty_block);
 
           // Update results
           results.nodes_moved.push_back(curr_node->id());
@@ -751,11 +1849,30 @@ class SBM {
 
         } // End accepted if statement
 
-        // Check for user breakout every 100 iterations.
+        // Check for user breakout (or a cancelled job) every 100 iterations.
         steps_taken = (steps_taken + 1) % 100;
-        if (steps_taken == 0) ALLOW_USER_BREAKOUT;
+        if (steps_taken == 0 && interruptible) ALLOW_USER_BREAKOUT;
+        if (steps_taken == 0 && stop_requested()) break;
       } // End current sweep
 
+      if (use_dense) {
+        partition.sync_nodes([&](const int r, const int s) { return dense_counts.counts_row(r)[s]; });
+      }
+
+      const int n_node_moves = n_nodes_moved;
+
+      // Let the number of blocks change by whole blocks at a time, roughly one
+      // proposal for every two blocks
+      if (variable_num_blocks && !stop_requested()) {
+        const int n_merge_split = n_nodes_at_level(block_level) / 2 + 1;
+        Node_Vec moved_nodes;
+        for (int m = 0; m < n_merge_split; m++) {
+          entropy_delta += merge_split_move(level, beta, moved_nodes, track_pairs ? &pair_moves : nullptr);
+          for (const Node* moved : moved_nodes) results.nodes_moved.push_back(moved->id());
+          n_nodes_moved += moved_nodes.size();
+        }
+      }
+
       // Update results for this sweep
       results.add(entropy_delta, n_nodes_moved);
       results.entropy_delta += entropy_delta;
@@ -763,26 +1880,164 @@ class SBM {
       // Update the concensus pairs map with results if needed.
       if (track_pairs) results.block_consensus.update_pair_tracking_map(pair_moves);
 
-      ALLOW_USER_BREAKOUT; // Let R used break out of loop if need be
+      // Checkpoints go between whole sweeps, the last one doesn't need one
+      const int n_done = i + 1;
+      if (checkpointed && n_done % checkpoint_every == 0 && n_done < n_sweeps && !stop_requested()) {
+        write_sweep_checkpoint(n_sweeps, eps, variable_num_blocks, track_pairs, level, heat_bath, n_done, results, nodes);
+      }
+
+      if (interruptible) ALLOW_USER_BREAKOUT; // Let R used break out of loop if need be
 
+      if (job_control) job_control->sweep_done(entropy_delta, n_nodes_at_level(block_level), n_proposed, n_node_moves);
+      if (stop_requested()) {
+        results.stop_early();
+        break;
+      }
     } // End multi-sweep loop
 
-    if (variable_num_blocks) {
-      // Cleanup the single empty block for each type
-      for (const auto& blocks_of_type : get_nodes_at_level(block_level)) {
-        for (const auto& block : blocks_of_type) {
-          // No need to continue so break out
-          // (also would cause problems by modifing vector we're looping over)
-          if (block->is_empty()) {
-            delete_node(block);
-            break;
-          }
-        }
+    // Cleanup the empty block kept for each type
+    if (variable_num_blocks) remove_empty_blocks(block_level);
+    return results;
+  }
+
+  // =========================================================================
+  // Incremental Updates
+  // =========================================================================
+  // Nodes and edges can be added to a model that already has blocks. Block
+  // degrees and edge counts take in each new edge as it's added and new data
+  // nodes start in a random block of their type. place_new_nodes() moves every
+  // new node with edges into the block of its type that fits it best and then
+  // runs sweeps over only the new nodes, the ends of new edges, and their
+  // neighbors. The number of blocks stays fixed. The first entry of the
+  // results is the placement, the rest are the sweeps.
+  public:
+  MCMC_Sweeps place_new_nodes(const int n_sweeps, const double& eps)
+  {
+    if (!node_level_has_blocks(0)) LOGIC_ERROR("Model has no blocks to place nodes into. Use initialize_blocks() first.");
+
+    return type_layout() == single_neighbor_type
+        ? place_and_refine<single_neighbor_type>(n_sweeps, eps)
+        : place_and_refine<mixed_neighbor_types>(n_sweeps, eps);
+  }
+
+  int n_unplaced_nodes() const
+  {
+    return unplaced_nodes.size();
+  }
+
+  private:
+  // Moves node into the block of its type that lowers entropy the most (or
+  // leaves it where it is) and returns the change in entropy
+  double place_greedily(Node* node, const double& eps)
+  {
+    const Node_UPtr_Vec& blocks_of_type = get_nodes_of_type(node->type(), 1);
+
+    Node_Vec candidates;
+    candidates.reserve(blocks_of_type.size());
+    for (const auto& block : blocks_of_type) candidates.push_back(block.get());
+
+    const auto scores = get_move_results(node, candidates, n_possible_neighbor_blocks(node), eps);
+
+    // Ties go to the current block, then the earliest candidate
+    Node* best_block  = node->parent();
+    double best_delta = 0.0;
+    for (int i = 0; i < scores.size(); i++) {
+      if (scores[i].entropy_delta < best_delta) {
+        best_block = candidates[i];
+        best_delta = scores[i].entropy_delta;
       }
     }
+
+    swap_blocks(node, best_block, false);
+    return best_delta;
+  }
+
+  template <Type_Layout Layout>
+  MCMC_Sweeps place_and_refine(const int n_sweeps, const double& eps)
+  {
+    MCMC_Sweeps results(n_sweeps + 1);
+
+    // Nodes without edges yet fit anywhere so they keep waiting
+    Node_Vec still_unplaced;
+    int n_placed           = 0;
+    double placement_delta = 0.0;
+    for (Node* node : unplaced_nodes) {
+      if (node->degree() == 0) {
+        still_unplaced.push_back(node);
+        continue;
+      }
+
+      Node* old_block = node->parent();
+      placement_delta += place_greedily(node, eps);
+      changed_nodes.push_back(node);
+
+      if (node->parent() != old_block) {
+        results.nodes_moved.push_back(node->id());
+        n_placed++;
+      }
+    }
+    results.add(placement_delta, n_placed);
+    results.entropy_delta += placement_delta;
+
+    // Sweep the changed nodes along with everything they connect to
+    Node_Vec local_nodes;
+    Flat_Hash_Set<const Node*> in_local;
+    for (Node* node : changed_nodes) {
+      if (in_local.insert(node).second) local_nodes.push_back(node);
+      for (const auto& neighbor : node->neighbors()) {
+        if (in_local.insert(neighbor.node).second) local_nodes.push_back(neighbor.node);
+      }
+    }
+    unplaced_nodes = std::move(still_unplaced);
+    changed_nodes.clear();
+
+    // Small sets of blocks are scored from a dense count matrix, as in sweeps
+    const int block_level = 1;
+    const bool use_dense  = n_nodes_at_level(block_level) <= DENSE_BLOCK_THRESHOLD;
+    Dense_Block_Counts dense_counts = use_dense && n_sweeps > 0
+        ? Dense_Block_Counts(get_flat_level(block_level))
+        : Dense_Block_Counts();
+
+    std::vector<double> sweep_draws;
+    for (int i = 0; i < n_sweeps; i++) {
+      int n_nodes_moved    = 0;
+      double entropy_delta = 0;
+
+      sampler.shuffle(local_nodes);
+      sampler.fill_unif(sweep_draws, n_move_draws * local_nodes.size());
+
+      for (int node_i = 0; node_i < local_nodes.size(); node_i++) {
+        Node* curr_node = local_nodes[node_i];
+        if (curr_node->degree() == 0) continue;
+
+        const double* draws      = &sweep_draws[n_move_draws * node_i];
+        Node* proposed_new_block = propose_move<Layout>(curr_node, block_level, eps, draws);
+        if (proposed_new_block == curr_node->parent()) continue;
+
+        const int n_possible                = n_possible_neighbor_blocks(curr_node);
+        const Move_Results proposal_results = use_dense
+            ? dense_counts.move_results(curr_node, proposed_new_block, n_possible, eps, 1.0)
+            : get_move_results(curr_node, proposed_new_block, n_possible, eps);
+        if (proposal_results.prob_of_accept <= draws[accept_draw]) continue;
+
+        if (use_dense) dense_counts.commit_move(curr_node, proposed_new_block);
+        swap_blocks(curr_node, proposed_new_block, false);
+        results.nodes_moved.push_back(curr_node->id());
+        n_nodes_moved++;
+        entropy_delta += proposal_results.entropy_delta;
+      }
+
+      results.add(entropy_delta, n_nodes_moved);
+      results.entropy_delta += entropy_delta;
+
+      if (interruptible) ALLOW_USER_BREAKOUT;
+    }
+
     return results;
   }
 
+  public:
+
   Collapse_Results collapse_blocks(const int node_level,
                                    const int B_end,
                                    const int n_checks_per_block,
@@ -798,9 +2053,6 @@ class SBM {
                                        + as_str(B_end)
                                        + " blocks.\n There needs to be at least one block per node type.");
 
-    const int block_level = node_level + 1;
-    const bool using_mcmc = n_mcmc_sweeps > 0;
-
     // Initialize struct to hold results of collapse
     auto results = Collapse_Results(B_end);
 
@@ -810,77 +2062,753 @@ class SBM {
     // Initialize one-block-per-node
     initialize_blocks();
 
-    // Setup variable to track the current number of blocks in the model
-    int B_cur = n_nodes_at_level(block_level);
+    // Record the starting partition and keep the nodes being merged in the
+    // same order so each step only needs the nodes that changed blocks
+    Collapse_Position position;
+    results.states.initial_state = compact_state_below(node_level + 1, position.nodes);
 
-    // Lambda to calculate how many merges a step needs
-    auto calc_num_merges = [&B_end, &sigma](const int B) {
-      // How many blocks the sigma hueristic wants network to have after next move
-      // max of this value and target is taken to avoid overshooting goal
-      const int B_next = std::max(int(std::floor(double(B) / sigma)),
-                                  B_end);
+    position.current_blocks = results.states.initial_state.back();
+    for (int i = 0; i < position.nodes.size(); i++) {
+      position.block_index.emplace(position.nodes[i]->parent(), position.current_blocks[i]);
+    }
 
-      return std::max(B - B_next, 1);
+    return run_collapse(node_level, B_end, n_checks_per_block, n_mcmc_sweeps, sigma, eps, report_all_steps, allow_exhaustive,
+                        std::move(results), position);
+  }
+
+  private:
+  // Merges from the current partition down, for both new and resumed collapses
+  Collapse_Results run_collapse(const int node_level,
+                                const int B_end,
+                                const int n_checks_per_block,
+                                const int n_mcmc_sweeps,
+                                const double& sigma,
+                                const double& eps,
+                                const bool report_all_steps,
+                                const bool allow_exhaustive,
+                                Collapse_Results results,
+                                Collapse_Position& position)
+  {
+    if (job_control) {
+      job_control->set_entropy(entropy(node_level));
+      job_control->set_n_blocks(n_nodes_at_level(node_level + 1));
+    }
+
+    auto record_step = [&]() {
+      std::vector<int> moved, blocks;
+      for (int i = 0; i < position.nodes.size(); i++) {
+        const int block_i = position.block_index.at(position.nodes[i]->parent());
+        if (block_i != position.current_blocks[i]) {
+          moved.push_back(i);
+          blocks.push_back(block_i);
+          position.current_blocks[i] = block_i;
+        }
+      }
+      results.states.add_step(std::move(moved), std::move(blocks));
     };
 
-    // Keep doing merges until we've reached the desired number of blocks
-    while (B_cur > B_end) {
-      const int n_merges_to_make = calc_num_merges(B_cur);
+    merge_down_to(node_level,
+                  B_end,
+                  n_checks_per_block,
+                  n_mcmc_sweeps,
+                  sigma,
+                  eps,
+                  allow_exhaustive,
+                  [&](const Block_Mergers& merge_result) {
+                    // Update results stuct
+                    results.entropy_delta += merge_result.entropy_delta;
+
+                    // Merge deltas are estimates so jobs report the exact entropy
+                    if (job_control) job_control->merge_step_done(entropy(node_level), merge_result.n_blocks);
+
+                    if (report_all_steps) {
+                      results.merge_steps.push_back(merge_result);
+                      record_step();
+                    }
+
+                    // Checkpoints go between merge steps, the last one doesn't need one
+                    position.step++;
+                    if (checkpoint_every > 0 && position.step % checkpoint_every == 0
+                        && merge_result.n_blocks > B_end && !stop_requested()) {
+                      write_collapse_checkpoint(node_level, B_end, n_checks_per_block, n_mcmc_sweeps, sigma, eps,
+                                                report_all_steps, allow_exhaustive, results, position);
+                    }
+                  });
+
+    if (!report_all_steps) record_step();
+
+    // A cancelled job stops short of the target
+    if (stop_requested()) results.n_blocks = n_nodes_at_level(node_level + 1);
+    results.final_entropy = entropy(node_level);
 
-      // Perform merges
-      auto merge_result = agglomerative_merge(this,
-                                              block_level,
-                                              n_merges_to_make,
-                                              n_checks_per_block,
-                                              eps,
-                                              allow_exhaustive);
-      // Update B_cur
-      B_cur -= merge_result.n_merges_made();
+    return results;
+  }
 
-      if (using_mcmc) {
-        // Update the merge results entropy delta with the changes caused by MCMC sweep
-        merge_result.entropy_delta += mcmc_sweep(n_mcmc_sweeps,
-                                                 eps,        // eps
-                                                 false,      // variable num blocks
-                                                 false,      // track pairs
-                                                 node_level, // level
-                                                 false)      // verbose
-                                          .entropy_delta;
+  public:
+  // Builds a full hierarchy of blocks in one pass. Starting from the data
+  // nodes, each level is collapsed into a level of blocks 1/level_ratio its
+  // size until there is a single block per node type. Since blocks keep their
+  // edge counts to other blocks, merges at higher levels only touch those
+  // counts, not the data level edges. After building, every level is refined
+  // jointly with sweeps that move the nodes at each level between the blocks
+  // above them.
+  Nested_Results fit_nested(const double& level_ratio,
+                            const int n_checks_per_block,
+                            const int n_mcmc_sweeps,
+                            const int n_nested_sweeps,
+                            const double& sigma,
+                            const double& eps,
+                            const bool allow_exhaustive = true)
+  {
+    if (level_ratio <= 1) LOGIC_ERROR("Level ratio must be greater than 1 so each level has fewer blocks than the last.");
+
+    auto results = Nested_Results();
+
+    remove_block_levels_above(0);
+
+    // Build levels upwards until we hit a single block per node type
+    int node_level = 0;
+    int B_cur      = n_nodes_at_level(0);
+
+    while (B_cur > n_types()) {
+      const int B_next = std::max(int(std::floor(B_cur / level_ratio)), n_types());
+
+      initialize_blocks();
+
+      merge_down_to(node_level,
+                    B_next,
+                    n_checks_per_block,
+                    n_mcmc_sweeps,
+                    sigma,
+                    eps,
+                    allow_exhaustive,
+                    [](const Block_Mergers&) {});
+
+      B_cur = n_nodes_at_level(++node_level);
+    }
+
+    // Refine all levels together. The top level is one block per type so there's
+    // nowhere for the level below it to move.
+    const int top_moving_level = n_levels() - 3;
+
+    for (int i = 0; i < n_nested_sweeps; i++) {
+      double entropy_delta = 0;
+
+      for (int level = 0; level <= top_moving_level; level++) {
+        entropy_delta += mcmc_sweep_at_temp(1,
+                                            eps,
+                                            false, // variable num blocks
+                                            false, // track pairs
+                                            level,
+                                            false, // verbose
+                                            1.0)   // beta
+                             .entropy_delta;
+      }
+      results.sweep_entropy_deltas.push_back(entropy_delta);
+    }
+
+    // Sweeps can leave blocks empty, clean them from the bottom up so parents of
+    // emptied blocks get checked after
+    for (int level = 1; level < n_levels(); level++) remove_empty_blocks(level);
+
+    for (int level = 1; level < n_levels(); level++) {
+      results.n_blocks.push_back(n_nodes_at_level(level));
+      results.level_entropy.push_back(entropy(level - 1));
+    }
+
+    return results;
+  }
+  // Parallel tempering: Runs one replica of the network per inverse temperature
+  // in betas (first must be 1, the "cold" chain) on its own thread. After every
+  // round of sweeps, neighboring temperatures propose to trade partitions using
+  // their running entropies. Swaps just exchange which replica sits at a given
+  // temperature so no partition is ever copied. This network is left in the
+  // final state of the cold chain.
+  Tempering_Results replica_exchange(const InOut_Double_Vec& betas,
+                                     const int n_rounds,
+                                     const int sweeps_per_round,
+                                     const double& eps,
+                                     const bool variable_num_blocks = false,
+                                     const int level                = 0,
+                                     const bool record_states       = false)
+  {
+    const int n_replicas = betas.size();
+
+    if (n_replicas < 2) LOGIC_ERROR("Replica exchange needs at least two temperatures.");
+    if (betas[0] != 1.0) LOGIC_ERROR("First inverse temperature must be 1 so there is a chain sampling the true posterior.");
+    if (!node_level_has_blocks(level)) LOGIC_ERROR("Replica exchange needs block structure to start from. Try initializing blocks.");
+
+    std::vector<double> temps(n_replicas);
+    for (int i = 0; i < n_replicas; i++) temps[i] = betas[i];
+
+    Tempering_Results results(temps, n_rounds);
 
-        // Check to see if we have any empty blocks after our MCMC sweep and remove them
-        auto empty_blocks = Node_Vec();
-        for_all_nodes_at_level(block_level, [&empty_blocks](const Node_UPtr& node) {
-          if (node->is_empty()) empty_blocks.push_back(node.get());
+    // Slot i always runs at temps[i]. Replicas and their entropies move between slots.
+    std::vector<std::unique_ptr<SBM>> replicas;
+    std::vector<double> entropies;
+    replicas.reserve(n_replicas);
+    entropies.reserve(n_replicas);
+
+    for (int i = 0; i < n_replicas; i++) {
+      replicas.push_back(clone(sampler.get_rand_int(std::numeric_limits<int>::max() - 1)));
+      replicas.back()->interruptible = false;
+      entropies.push_back(replicas.back()->entropy(level));
+    }
+
+    std::vector<double> round_deltas(n_replicas);
+    std::vector<std::exception_ptr> errors(n_replicas);
+
+    for (int round = 0; round < n_rounds; round++) {
+      std::vector<std::thread> workers;
+      workers.reserve(n_replicas);
+
+      for (int i = 0; i < n_replicas; i++) {
+        workers.emplace_back([&, i]() {
+          on_worker_thread() = true;
+          try {
+            round_deltas[i] = replicas[i]->mcmc_sweep_at_temp(sweeps_per_round,
+                                                              eps,
+                                                              variable_num_blocks,
+                                                              false, // track pairs
+                                                              level,
+                                                              false, // verbose
+                                                              temps[i])
+                                  .entropy_delta;
+          } catch (...) {
+            errors[i] = std::current_exception();
+          }
         });
+      }
 
-        // Update current number of blocks to account for the empty blocks
-        B_cur -= empty_blocks.size();
+      for (auto& worker : workers) worker.join();
 
-        // Remove those empty blocks
-        for (const auto& empty_block : empty_blocks) delete_node(empty_block);
+      // Errors get rethrown on this thread so they can make it back to R safely
+      for (const auto& error : errors) {
+        if (error) rethrow_worker_error(error);
       }
 
-      // Update results stuct
-      results.entropy_delta += merge_result.entropy_delta;
+      for (int i = 0; i < n_replicas; i++) entropies[i] += round_deltas[i];
 
-      // Add info on how many blocks are remaining to merge info
-      merge_result.n_blocks = B_cur;
+      // Alternate between even and odd neighbor pairs so every pair gets a chance
+      for (int i = round % 2; i + 1 < n_replicas; i += 2) {
+        const double log_accept = (temps[i] - temps[i + 1]) * (entropies[i] - entropies[i + 1]);
 
-      if (report_all_steps) {
-        results.merge_steps.push_back(merge_result);
-        results.states.push_back(state());
+        results.n_swaps_proposed[i]++;
+
+        if (log_accept >= 0 || sampler.draw_unif() < std::exp(log_accept)) {
+          std::swap(replicas[i], replicas[i + 1]);
+          std::swap(entropies[i], entropies[i + 1]);
+          results.n_swaps_accepted[i]++;
+        }
       }
-    }
 
-    if (!report_all_steps) {
-      results.states.push_back(state());
+      results.cold_entropy[round] = entropies[0];
+      if (record_states) results.cold_states.push_back(replicas[0]->compact_state());
+
+      if (interruptible) ALLOW_USER_BREAKOUT;
     }
 
-    results.final_entropy = entropy(node_level);
+    // Pick up where the cold chain left off
+    update_state(replicas[0]->compact_state());
+
+    return results;
+  }
+
+  // =========================================================================
+  // Background fitting
+  // =========================================================================
+  // Sweeps and collapses can run on a worker thread so the caller isn't
+  // blocked. The job works on a copy of the model, this one stays as it was
+  // until the job is collected and then takes on the job's final state. One
+  // job at a time. Arguments match mcmc_sweep() and collapse_blocks().
+  void start_sweep_job(const int n_sweeps,
+                       const double& eps,
+                       const bool variable_num_blocks,
+                       const bool track_pairs,
+                       const int level,
+                       const bool heat_bath)
+  {
+    launch_job(sweep_job, n_sweeps, [=](SBM* model, Fit_Job* running) {
+      running->sweep_results.reset(new MCMC_Sweeps(
+          model->mcmc_sweep(n_sweeps, eps, variable_num_blocks, track_pairs, level, false, heat_bath)));
+    });
+  }
 
+  void start_collapse_job(const int node_level,
+                          const int B_end,
+                          const int n_checks_per_block,
+                          const int n_mcmc_sweeps,
+                          const double& sigma,
+                          const double& eps,
+                          const bool report_all_steps,
+                          const bool allow_exhaustive)
+  {
+    launch_job(collapse_job, 0, [=](SBM* model, Fit_Job* running) {
+      running->collapse_results.reset(new Collapse_Results(
+          model->collapse_blocks(node_level, B_end, n_checks_per_block, n_mcmc_sweeps, sigma, eps, report_all_steps, allow_exhaustive)));
+    });
+  }
+
+  bool has_job() const { return bool(job); }
+
+  Job_Progress job_progress() const
+  {
+    if (!job) LOGIC_ERROR("No background job to report on.");
+    return job->control.progress(Job_Status(int(job->status)));
+  }
+
+  // Ask the job to stop. Sweeps check in every 100 nodes and collapses after
+  // every merge step. Whatever was done by then can still be collected.
+  void cancel_job()
+  {
+    if (!job) LOGIC_ERROR("No background job to cancel.");
+    job->control.request_cancel();
+  }
+
+  // Wait for the job to end, take on its state, and hand back its results
+  MCMC_Sweeps collect_sweep_job()
+  {
+    finish_job(sweep_job);
+    MCMC_Sweeps results = std::move(*job->sweep_results);
+    job.reset();
+    job_model.reset();
     return results;
   }
 
+  Collapse_Results collect_collapse_job()
+  {
+    finish_job(collapse_job);
+    Collapse_Results results = std::move(*job->collapse_results);
+    job.reset();
+    job_model.reset();
+    return results;
+  }
+
+  private:
+  bool stop_requested() const { return job_control && job_control->cancel_requested(); }
+
+  // Copy the model and run fit on it from a new worker thread. Errors are
+  // thrown there as plain std exceptions (see on_worker_thread()) and held
+  // until the job is collected so they reach R from the caller's thread.
+  template <typename Fit_Fn>
+  void launch_job(const Job_Kind kind, const int n_steps, Fit_Fn fit)
+  {
+    if (job) LOGIC_ERROR("Model already has a background job. Collect it before starting another.");
+
+    job_model = clone(sampler.get_rand_int(std::numeric_limits<int>::max() - 1));
+    job_model->interruptible = false;
+    job_model->set_checkpoint(checkpoint_path, checkpoint_every);
+    job.reset(new Fit_Job(kind, n_steps));
+    job_model->job_control = &job->control;
+
+    SBM* model       = job_model.get();
+    Fit_Job* running = job.get();
+    running->worker  = std::thread([model, running, fit]() {
+      on_worker_thread() = true;
+      try {
+        fit(model, running);
+        running->status = running->control.cancel_requested() ? job_cancelled : job_finished;
+      } catch (...) {
+        running->error  = std::current_exception();
+        running->status = job_failed;
+      }
+    });
+  }
+
+  void finish_job(const Job_Kind kind)
+  {
+    if (!job) LOGIC_ERROR("No background job to collect.");
+    if (job->control.kind != kind) LOGIC_ERROR("Background job is a " + job_progress().kind + " job.");
+
+    // Poll rather than block outright so R can still break out
+    while (!job->done()) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(10));
+      if (interruptible) ALLOW_USER_BREAKOUT;
+    }
+    job->worker.join();
+
+    if (job->error) {
+      const std::exception_ptr error = job->error;
+      job.reset();
+      job_model.reset();
+      rethrow_worker_error(error);
+    }
+
+    // Go through string state so blocks keep their ids
+    if (job_model->n_levels() > 1) {
+      const State_Dump job_state = job_model->state();
+      update_state(job_state.ids, job_state.types, job_state.parents, job_state.levels);
+    } else {
+      remove_block_levels_above(0);
+    }
+    block_counter = std::max(block_counter, job_model->block_counter);
+  }
+
+  public:
+  // =========================================================================
+  // Checkpoints
+  // =========================================================================
+  // Long sweeps and collapses can save where they are to a binary file so an
+  // interrupted run can be picked back up. A checkpoint holds the arguments of
+  // the run, how far it got, the random generator, the full block structure
+  // (including the order blocks are stored and were created in, as moves
+  // depend on both) and the results so far. Resuming needs the same network,
+  // built the same way, and continues exactly as the run would have.
+  void set_checkpoint(const string& path, const int every)
+  {
+    if (every > 0 && path.empty()) LOGIC_ERROR("Checkpoints need a file to be written to.");
+    checkpoint_path  = path;
+    checkpoint_every = std::max(every, 0);
+  }
+
+  MCMC_Sweeps resume_sweep(const string& path)
+  {
+    Checkpoint_Reader in(path);
+    if (in.read<string>() != "sweep") LOGIC_ERROR(path + " is a checkpoint of a collapse. Use resume_collapse().");
+
+    const int n_sweeps             = in.read<int>();
+    const double eps               = in.read<double>();
+    const bool variable_num_blocks = in.read<bool>();
+    const bool track_pairs         = in.read<bool>();
+    const int level                = in.read<int>();
+    const bool heat_bath           = in.read<bool>();
+
+    Sweep_Resume resume(n_sweeps);
+    resume.first_sweep = in.read<int>();
+    read_model_state(in);
+
+    std::vector<double> entropy_deltas;
+    std::vector<int> n_nodes_moved;
+    in.read_into(entropy_deltas);
+    in.read_into(n_nodes_moved);
+    if (entropy_deltas.size() != resume.first_sweep || n_nodes_moved.size() != resume.first_sweep) {
+      LOGIC_ERROR("Checkpoint file " + path + " is corrupt");
+    }
+    for (int i = 0; i < resume.first_sweep; i++) resume.results.add(entropy_deltas[i], n_nodes_moved[i]);
+    in.read_into(resume.results.nodes_moved);
+    in.read_into(resume.results.entropy_delta);
+
+    std::vector<string> pairs;
+    std::vector<bool> connected;
+    std::vector<int> times_connected;
+    in.read_into(pairs);
+    in.read_into(connected);
+    in.read_into(times_connected);
+    for (int i = 0; i < pairs.size(); i++) {
+      Pair_Status status(connected.at(i));
+      status.times_connected = times_connected.at(i);
+      resume.results.block_consensus.node_pairs.emplace(pairs[i], status);
+    }
+
+    resume.order = read_node_positions(in, get_flat_level(level));
+
+    return sweep_with_layout(n_sweeps, eps, variable_num_blocks, track_pairs, level, false, 1.0, heat_bath,
+                             checkpoint_every > 0, &resume);
+  }
+
+  Collapse_Results resume_collapse(const string& path)
+  {
+    Checkpoint_Reader in(path);
+    if (in.read<string>() != "collapse") LOGIC_ERROR(path + " is a checkpoint of sweeps. Use resume_sweep().");
+
+    const int node_level         = in.read<int>();
+    const int B_end              = in.read<int>();
+    const int n_checks_per_block = in.read<int>();
+    const int n_mcmc_sweeps      = in.read<int>();
+    const double sigma           = in.read<double>();
+    const double eps             = in.read<double>();
+    const bool report_all_steps  = in.read<bool>();
+    const bool allow_exhaustive  = in.read<bool>();
+
+    Collapse_Position position;
+    position.step = in.read<int>();
+    read_model_state(in);
+
+    Collapse_Results results(B_end);
+    in.read_into(results.entropy_delta);
+    results.merge_steps.resize(in.read_size());
+    for (auto& step : results.merge_steps) {
+      in.read_into(step.entropy_delta);
+      in.read_into(step.n_blocks);
+      in.read_into(step.ran_out_of_merges);
+      in.read_into(step.merge_from);
+      in.read_into(step.merge_into);
+    }
+    in.read_into(results.states.initial_state);
+    in.read_into(results.states.moved_nodes);
+    in.read_into(results.states.new_blocks);
+
+    position.nodes = read_node_positions(in, get_flat_level(node_level));
+    in.read_into(position.current_blocks);
+
+    std::vector<int> block_indices;
+    in.read_into(block_indices);
+    const Node_Vec blocks = get_flat_level(node_level + 1);
+    if (block_indices.size() != blocks.size() || position.current_blocks.size() != position.nodes.size()) {
+      LOGIC_ERROR("Checkpoint file " + path + " is corrupt");
+    }
+    for (int i = 0; i < blocks.size(); i++) position.block_index.emplace(blocks[i], block_indices[i]);
+
+    return run_collapse(node_level, B_end, n_checks_per_block, n_mcmc_sweeps, sigma, eps, report_all_steps, allow_exhaustive,
+                        std::move(results), position);
+  }
+
+  private:
+  void write_sweep_checkpoint(const int n_sweeps,
+                              const double& eps,
+                              const bool variable_num_blocks,
+                              const bool track_pairs,
+                              const int level,
+                              const bool heat_bath,
+                              const int n_done,
+                              const MCMC_Sweeps& results,
+                              const Node_Vec& order) const
+  {
+    Checkpoint_Writer out(checkpoint_path);
+    out.write(string("sweep"));
+    out.write(n_sweeps);
+    out.write(eps);
+    out.write(variable_num_blocks);
+    out.write(track_pairs);
+    out.write(level);
+    out.write(heat_bath);
+    out.write(n_done);
+    write_model_state(out);
+
+    out.write(std::vector<double>(results.entropy_deltas.begin(), results.entropy_deltas.begin() + n_done));
+    out.write(std::vector<int>(results.n_nodes_moved.begin(), results.n_nodes_moved.begin() + n_done));
+    out.write(results.nodes_moved);
+    out.write(results.entropy_delta);
+
+    std::vector<string> pairs;
+    std::vector<bool> connected;
+    std::vector<int> times_connected;
+    for (const auto& pair : results.block_consensus.node_pairs) {
+      pairs.push_back(pair.first);
+      connected.push_back(pair.second.connected);
+      times_connected.push_back(pair.second.times_connected);
+    }
+    out.write(pairs);
+    out.write(connected);
+    out.write(times_connected);
+
+    write_node_positions(out, order, get_flat_level(level));
+    out.commit();
+  }
+
+  void write_collapse_checkpoint(const int node_level,
+                                 const int B_end,
+                                 const int n_checks_per_block,
+                                 const int n_mcmc_sweeps,
+                                 const double& sigma,
+                                 const double& eps,
+                                 const bool report_all_steps,
+                                 const bool allow_exhaustive,
+                                 const Collapse_Results& results,
+                                 const Collapse_Position& position) const
+  {
+    Checkpoint_Writer out(checkpoint_path);
+    out.write(string("collapse"));
+    out.write(node_level);
+    out.write(B_end);
+    out.write(n_checks_per_block);
+    out.write(n_mcmc_sweeps);
+    out.write(sigma);
+    out.write(eps);
+    out.write(report_all_steps);
+    out.write(allow_exhaustive);
+    out.write(position.step);
+    write_model_state(out);
+
+    out.write(results.entropy_delta);
+    out.write(int(results.merge_steps.size()));
+    for (const auto& step : results.merge_steps) {
+      out.write(step.entropy_delta);
+      out.write(step.n_blocks);
+      out.write(step.ran_out_of_merges);
+      out.write(step.merge_from);
+      out.write(step.merge_into);
+    }
+    out.write(results.states.initial_state);
+    out.write(results.states.moved_nodes);
+    out.write(results.states.new_blocks);
+
+    write_node_positions(out, position.nodes, get_flat_level(node_level));
+    out.write(position.current_blocks);
+
+    std::vector<int> block_indices;
+    for (const Node* block : get_flat_level(node_level + 1)) block_indices.push_back(position.block_index.at(block));
+    out.write(block_indices);
+    out.commit();
+  }
+
+  // Nodes are saved by their position in a list both sides can rebuild
+  void write_node_positions(Checkpoint_Writer& out, const Node_Vec& to_write, const Node_Vec& reference) const
+  {
+    std::unordered_map<const Node*, int> position;
+    for (int i = 0; i < reference.size(); i++) position.emplace(reference[i], i);
+
+    std::vector<int> positions;
+    positions.reserve(to_write.size());
+    for (const Node* node : to_write) positions.push_back(position.at(node));
+    out.write(positions);
+  }
+
+  Node_Vec read_node_positions(Checkpoint_Reader& in, const Node_Vec& reference) const
+  {
+    std::vector<int> positions;
+    in.read_into(positions);
+
+    Node_Vec nodes_read;
+    nodes_read.reserve(positions.size());
+    for (const int i : positions) {
+      if (i < 0 || i >= reference.size()) LOGIC_ERROR("Checkpoint refers to a node the network doesn't have");
+      nodes_read.push_back(reference[i]);
+    }
+    return nodes_read;
+  }
+
+  // Random generator and everything about the block structure later moves
+  // can depend on. Nodes are referred to by their position within their level
+  // and type. Data nodes are checked against the network rather than rebuilt.
+  void write_model_state(Checkpoint_Writer& out) const
+  {
+    std::ostringstream generator_state;
+    generator_state << sampler.generator;
+    out.write(generator_state.str());
+
+    out.write(node_serial);
+    out.write(block_counter);
+
+    std::vector<string> data_ids;
+    std::vector<int> data_serials;
+    for (const Node* node : data_nodes) {
+      data_ids.push_back(node->id());
+      data_serials.push_back(node->serial());
+    }
+    out.write(data_ids);
+    out.write(data_serials);
+
+    // Data nodes by their index in data_nodes, as initializing blocks shuffles them
+    write_node_positions(out, get_flat_level(0), data_nodes);
+
+    out.write(n_levels());
+    for (int level = 1; level < n_levels(); level++) {
+      for (int type = 0; type < n_types(); type++) {
+        Node_Vec children_of_type, blocks_of_type;
+        for (const auto& child : nodes[level - 1][type]) children_of_type.push_back(child.get());
+        for (const auto& block : nodes[level][type]) blocks_of_type.push_back(block.get());
+
+        out.write(int(blocks_of_type.size()));
+        for (const Node* block : blocks_of_type) {
+          out.write(block->id());
+          out.write(block->serial());
+          write_node_positions(out, block->children(), children_of_type);
+        }
+
+        const auto empty_it = empty_blocks.find(std::make_pair(level, type));
+        write_node_positions(out, empty_it == empty_blocks.end() ? Node_Vec() : empty_it->second, blocks_of_type);
+      }
+    }
+
+    out.write(int(block_pool.size()));
+    for (const auto& pool : block_pool) {
+      out.write(pool.first.first);
+      out.write(pool.first.second);
+      out.write(int(pool.second.size()));
+      for (const auto& block : pool.second) {
+        out.write(block->id());
+        out.write(block->serial());
+      }
+    }
+  }
+
+  void read_model_state(Checkpoint_Reader& in)
+  {
+    std::istringstream generator_state(in.read<string>());
+    generator_state >> sampler.generator;
+    if (!generator_state) LOGIC_ERROR("Checkpoint has a corrupt random generator state");
+
+    const int saved_node_serial   = in.read<int>();
+    const int saved_block_counter = in.read<int>();
+
+    std::vector<string> data_ids;
+    std::vector<int> data_serials;
+    in.read_into(data_ids);
+    in.read_into(data_serials);
+    bool same_network = data_ids.size() == data_nodes.size() && data_serials.size() == data_nodes.size();
+    for (int i = 0; same_network && i < data_nodes.size(); i++) {
+      same_network = data_ids[i] == data_nodes[i]->id() && data_serials[i] == data_nodes[i]->serial();
+    }
+    if (!same_network) {
+      LOGIC_ERROR("Checkpoint was written for a different network. Build the network the same way, "
+                  "including any node reordering, before resuming.");
+    }
+
+    remove_block_levels_above(0);
+    block_pool.clear();
+
+    // Put data nodes back in the order they were stored in. Checked to hold
+    // every node once before anything is moved.
+    const Node_Vec data_order = read_node_positions(in, data_nodes);
+    std::unordered_map<const Node*, Node_UPtr*> data_owners;
+    for (auto& nodes_of_type : nodes[0]) {
+      for (auto& node : nodes_of_type) data_owners.emplace(node.get(), &node);
+    }
+    const bool full_order = data_order.size() == data_nodes.size()
+        && std::unordered_set<const Node*>(data_order.begin(), data_order.end()).size() == data_nodes.size();
+    if (!full_order) LOGIC_ERROR("Checkpoint data nodes don't match network");
+
+    Type_Vec data_level(n_types());
+    for (Node* node : data_order) data_level[node->type()].push_back(std::move(*data_owners.at(node)));
+    nodes[0] = std::move(data_level);
+
+    const int saved_levels = in.read<int>();
+    for (int level = 1; level < saved_levels; level++) {
+      build_block_level();
+
+      for (int type = 0; type < n_types(); type++) {
+        Node_Vec children_of_type;
+        for (const auto& child : nodes[level - 1][type]) children_of_type.push_back(child.get());
+
+        Node_Vec blocks_of_type(in.read_size());
+        for (Node*& block : blocks_of_type) {
+          const string id  = in.read<string>();
+          const int serial = in.read<int>();
+
+          block = new Node(id, level, type, serial);
+          nodes[level][type].emplace_back(block);
+          block->track_emptiness(&empty_blocks[std::make_pair(level, type)]);
+          count_node(level, type, 1);
+
+          for (Node* child : read_node_positions(in, children_of_type)) child->set_parent(block);
+        }
+
+        // Empty blocks go back in the order they were found empty
+        Node_Vec& empty_of_type = empty_blocks[std::make_pair(level, type)];
+        Node_Vec saved_empty    = read_node_positions(in, blocks_of_type);
+        if (saved_empty.size() != empty_of_type.size()) LOGIC_ERROR("Checkpoint empty blocks don't match its blocks");
+        empty_of_type = std::move(saved_empty);
+      }
+    }
+
+    const int n_pools = in.read<int>();
+    for (int i = 0; i < n_pools; i++) {
+      const int level     = in.read<int>();
+      const int type      = in.read<int>();
+      Node_UPtr_Vec& pool = block_pool[std::make_pair(level, type)];
+      pool.resize(in.read_size());
+      for (auto& block : pool) {
+        const string id = in.read<string>();
+        block.reset(new Node(id, level, type, in.read<int>()));
+      }
+    }
+
+    node_serial   = saved_node_serial;
+    block_counter = saved_block_counter;
+  }
+
+  public:
   // =============================================================================
   // Model State
   // =============================================================================
@@ -960,6 +2888,183 @@ class SBM {
     }
   }
 
+  // Loads blocks from a state saved on an earlier snapshot of the network so
+  // fitting can pick up from there. Entries for nodes no longer in the network
+  // are dropped, as are blocks left without any children. Data nodes the state
+  // doesn't cover go into the block of their type that fits their edges best,
+  // as with place_new_nodes(). Returns how many nodes were new to the state.
+  int warm_start(const InOut_String_Vec& ids,
+                 const InOut_String_Vec& types,
+                 const InOut_String_Vec& parents,
+                 const InOut_Int_Vec& levels,
+                 const double& eps)
+  {
+    // Walk up the levels of the state. An entry is kept if its node is in the
+    // network or, for blocks, if it kept a child in the level below.
+    std::unordered_set<string> present;
+    for (const Node* node : data_nodes) present.insert(node->id());
+
+    std::vector<int> kept;
+    std::unordered_set<string> kept_blocks;
+    int last_level = 0;
+    for (int i = 0; i < ids.size(); i++) {
+      if (levels[i] != last_level) {
+        if (levels[i] < last_level) LOGIC_ERROR("State entries need to be ordered by level");
+        present = std::move(kept_blocks);
+        kept_blocks.clear();
+        last_level = levels[i];
+      }
+
+      if (present.count(to_str(ids[i])) == 0) continue;
+      kept.push_back(i);
+      kept_blocks.insert(to_str(parents[i]));
+    }
+
+    const int n_kept = kept.size();
+    InOut_String_Vec kept_ids(n_kept), kept_types(n_kept), kept_parents(n_kept);
+    InOut_Int_Vec kept_levels(n_kept);
+    for (int j = 0; j < n_kept; j++) {
+      kept_ids[j]     = ids[kept[j]];
+      kept_types[j]   = types[kept[j]];
+      kept_parents[j] = parents[kept[j]];
+      kept_levels[j]  = levels[kept[j]];
+    }
+    update_state(kept_ids, kept_types, kept_parents, kept_levels);
+
+    // Everyone else starts in a random block and gets placed from there
+    for (Node* node : data_nodes) {
+      if (node->has_parent()) continue;
+      node->set_parent(starting_block(node->type()));
+      unplaced_nodes.push_back(node);
+    }
+    const int n_new = unplaced_nodes.size();
+
+    place_new_nodes(0, eps);
+    return n_new;
+  }
+
+  Compact_State compact_state() const
+  {
+    if (n_levels() == 1) LOGIC_ERROR("No state to export - Try adding blocks");
+
+    Node_Vec last_children;
+    return compact_state_below(n_levels() - 1, last_children);
+  }
+
+  private:
+  // Compact state of all levels below max_level. Nodes of the level right below
+  // max_level are left in last_children in the order the state indexes them.
+  Compact_State compact_state_below(const int max_level, Node_Vec& last_children) const
+  {
+    Compact_State state(max_level);
+
+    // Walk up levels, giving each parent an index the first time it's seen
+    Node_Vec level_nodes = data_nodes;
+    for (int level = 0; level < max_level; level++) {
+      std::unordered_map<const Node*, int> parent_index;
+      parent_index.reserve(n_nodes_at_level(level + 1));
+
+      Node_Vec parent_nodes;
+      std::vector<int>& parents = state[level];
+      parents.reserve(level_nodes.size());
+
+      for (const auto& node : level_nodes) {
+        Node* parent = node->parent();
+        if (parent == nullptr) LOGIC_ERROR("Node " + node->id() + " has no parent, can't export state");
+
+        const auto index_it = parent_index.emplace(parent, parent_nodes.size());
+        if (index_it.second) parent_nodes.push_back(parent);
+
+        parents.push_back(index_it.first->second);
+      }
+
+      last_children = std::move(level_nodes);
+      level_nodes   = std::move(parent_nodes);
+    }
+
+    return state;
+  }
+
+  public:
+  // Ids of data nodes in the order used by compact states
+  InOut_String_Vec data_node_ids() const
+  {
+    InOut_String_Vec ids(data_nodes.size());
+    for (int i = 0; i < data_nodes.size(); i++) ids[i] = data_nodes[i]->id();
+    return ids;
+  }
+
+  void update_state(const Compact_State& state)
+  {
+    if (state.empty()) LOGIC_ERROR("State has no block levels");
+    if (state[0].size() != data_nodes.size()) {
+      LOGIC_ERROR("State has " + as_str(state[0].size()) + " data nodes but network has "
+                  + as_str(data_nodes.size()));
+    }
+
+    remove_block_levels_above(0);
+
+    Node_Vec level_nodes = data_nodes;
+    for (const auto& parents : state) {
+      if (parents.size() != level_nodes.size()) {
+        LOGIC_ERROR("State level has " + as_str(parents.size()) + " entries for "
+                    + as_str(level_nodes.size()) + " nodes");
+      }
+
+      // Blocks take the type of their children so check that they all agree
+      const int n_blocks = parents.empty() ? 0 : *std::max_element(parents.begin(), parents.end()) + 1;
+      std::vector<int> block_types(n_blocks, -1);
+
+      for (int i = 0; i < parents.size(); i++) {
+        const int parent_i = parents[i];
+        if (parent_i < 0) RANGE_ERROR("Negative parent index in state");
+
+        int& block_type = block_types[parent_i];
+        if (block_type == -1) {
+          block_type = level_nodes[i]->type();
+        } else if (block_type != level_nodes[i]->type()) {
+          LOGIC_ERROR("Block " + as_str(parent_i) + " in state holds nodes of different types");
+        }
+      }
+
+      build_block_level();
+      const int block_level = n_levels() - 1;
+
+      Node_Vec blocks;
+      blocks.reserve(n_blocks);
+      for (const int block_type : block_types) {
+        if (block_type == -1) LOGIC_ERROR("State skips a block index. Block indices must be contiguous");
+        blocks.push_back(add_block_node(block_type, block_level));
+      }
+
+      for (int i = 0; i < parents.size(); i++) level_nodes[i]->set_parent(blocks[parents[i]]);
+
+      level_nodes = std::move(blocks);
+    }
+  }
+
+  // Return to the partition after a given step of a collapse
+  void update_state(const Collapse_History& history, const int step)
+  {
+    update_state(history.at(step));
+  }
+
+  // Same as above but with the history passed in pieces (as it comes from R)
+  void restore_collapse_step(const Compact_State& initial_state,
+                             const std::vector<std::vector<int>>& moved_nodes,
+                             const std::vector<std::vector<int>>& new_blocks,
+                             const int step)
+  {
+    if (moved_nodes.size() != new_blocks.size()) LOGIC_ERROR("Collapse history needs a block for every moved node");
+
+    Collapse_History history;
+    history.initial_state = initial_state;
+    history.moved_nodes   = moved_nodes;
+    history.new_blocks    = new_blocks;
+
+    update_state(history, step);
+  }
+
   // =========================================================================
   // Node Grabbers
   // =========================================================================
@@ -991,6 +3096,43 @@ class SBM {
                                              + " does not exist in network.");
   }
 
+  // Apply a function over all nodes at a level
+  template <typename Visit_Fn>
+  void for_all_nodes_at_level(const int level, Visit_Fn&& fn) const
+  {
+    check_for_level(level);
+    for (const auto& nodes_vec : nodes[level]) {
+      for (const auto& node : nodes_vec) fn(node);
+    }
+  }
+
+  // Apply a function to every connected pair of blocks at a level along with
+  // the number of edges between them. Each pair is visited once.
+  template <typename Pair_Fn>
+  void for_all_block_pairs(const int level, Pair_Fn fn) const
+  {
+    check_for_level(level);
+    for (const auto& nodes_vec : nodes[level]) {
+      for (const auto& block : nodes_vec) {
+        for (const auto& block_count : block->block_edges()) {
+          const Node* other = block_count.first;
+          if (other == block.get()) {
+            fn(other, other, block_count.second / 2);
+          } else if (Creation_Order()(block.get(), other)) {
+            fn(block.get(), other, block_count.second);
+          }
+        }
+      }
+    }
+  }
+
+  public:
+  // Blocks of a type at a level that currently have no children
+  const Node_Vec& empty_blocks_of_type(const int type_index, const int level)
+  {
+    return empty_blocks[std::make_pair(level, type_index)];
+  }
+
   // Get a vector of raw pointers to all nodes in a given level with no type separation
   Node_Vec get_flat_level(const int level) const
   {
@@ -1004,17 +3146,6 @@ class SBM {
     return all_nodes;
   }
 
-  // Apply a lambda function over all nodes in network
-  void for_all_nodes_at_level(const int level,
-                              std::function<void(const Node_UPtr& node)> fn) const
-  {
-    check_for_level(level);
-    for (const auto& nodes_vec : nodes[level]) {
-      std::for_each(nodes_vec.begin(), nodes_vec.end(), fn);
-    }
-  }
-
-  public:
   const Type_Vec& get_nodes_at_level(const int level) const
   {
     check_for_level(level);
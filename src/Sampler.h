@@ -5,7 +5,10 @@
 #define __SAMPLER_INCLUDED__
 
 #include "error_and_message_macros.h"
+#include <algorithm>
+#include <cstdint>
 #include <list>
+#include <numeric>
 #include <random>
 #include <vector>
 
@@ -72,6 +75,41 @@ class Sampler {
     return dist(generator);
   }
 
+  // =============================================================================
+  // Fill draws with n uniform (0 - 1) samples in one go. Two words off the
+  // engine seed a SplitMix64 counter stream for the batch: sample i is a hash
+  // of seed + i, so the loop carries no state from one sample to the next and
+  // the compiler is free to unroll and vectorize it. A batch is pinned down by
+  // the engine state it started from and never lands on zero or one.
+  // =============================================================================
+  void fill_unif(double* draws, const int n)
+  {
+    const std::uint64_t seed = (std::uint64_t(generator()) << 32) | std::uint64_t(generator());
+    const double scale       = 1.0 / 9007199254740992.0; // 2^-53
+
+    for (int i = 0; i < n; i++) {
+      std::uint64_t z = seed + std::uint64_t(i + 1) * 0x9e3779b97f4a7c15ULL;
+      z               = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z               = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      z ^= z >> 31;
+      draws[i] = (double(z >> 11) + 0.5) * scale;
+    }
+  }
+
+  void fill_unif(std::vector<double>& draws, const int n)
+  {
+    draws.resize(n);
+    fill_unif(draws.data(), n);
+  }
+
+  // =============================================================================
+  // Turn a uniform draw into an integer in [0, max_val]
+  // =============================================================================
+  static int unif_to_int(const double draw, const int max_val)
+  {
+    return std::min(int(draw * (max_val + 1.0)), max_val);
+  }
+
   // =============================================================================
   // Sample random node from vector
   // Easier than list because we can just index to a spot
@@ -111,6 +149,32 @@ class Sampler {
   {
     std::shuffle(vec.begin(), vec.end(), generator);
   }
+
+  // =============================================================================
+  // Fill out with a random order of ordered that only mixes elements within
+  // runs of chunk_size. Runs are visited in random order so every element still
+  // shows up once, but elements close together in ordered stay close in out.
+  // =============================================================================
+  template <typename T>
+  void chunk_shuffle(const std::vector<T>& ordered, std::vector<T>& out, const int chunk_size)
+  {
+    const int n        = ordered.size();
+    const int n_chunks = (n + chunk_size - 1) / chunk_size;
+
+    std::vector<int> chunk_order(n_chunks);
+    std::iota(chunk_order.begin(), chunk_order.end(), 0);
+    shuffle(chunk_order);
+
+    out.clear();
+    out.reserve(n);
+    for (const int chunk : chunk_order) {
+      const int chunk_start = out.size();
+      out.insert(out.end(),
+                 ordered.begin() + chunk * chunk_size,
+                 ordered.begin() + std::min(n, (chunk + 1) * chunk_size));
+      std::shuffle(out.begin() + chunk_start, out.end(), generator);
+    }
+  }
 };
 
 #endif
\ No newline at end of file
@@ -3,14 +3,17 @@
 #include <queue>
 
 #include "Ordered_Pair.h"
+#include "dense_block_counts.h"
 #include "model_helpers.h"
 
+// Held in plain std containers so collapses can run off of the main R thread
 struct Block_Mergers {
 
   double entropy_delta = 0.0;
   int n_blocks;
-  InOut_String_Vec merge_from;
-  InOut_String_Vec merge_into;
+  bool ran_out_of_merges = false; // Fewer merges made than asked for
+  std::vector<string> merge_from;
+  std::vector<string> merge_into;
   void add(const string& from, const string& into)
   {
     merge_from.push_back(from);
@@ -22,8 +25,11 @@ struct Block_Mergers {
   }
 };
 
-using Node_Set        = std::unordered_set<Node*>;
-using Node_Pair       = Ordered_Pair<Node*>;
+using Node_Set = std::unordered_set<Node*>;
+
+// Merge pairs (and so which block absorbs which, and how ties are broken) go
+// by creation order so collapses don't depend on where blocks sit in memory
+using Node_Pair       = Ordered_Pair<Node*, Creation_Order>;
 using Best_Move_Queue = std::priority_queue<std::pair<double, Node_Pair>>;
 
 inline double merge_entropy_delta(const Node_Pair& merge_pair)
@@ -79,7 +85,7 @@ inline double merge_entropy_delta(const Node_Pair& merge_pair)
 // =============================================================================
 // Runs efficient MCMC sweep algorithm on desired node level
 // =============================================================================
-template <typename Network>
+template <Type_Layout Layout, typename Network>
 inline Block_Mergers agglomerative_merge(Network* net,
                                          const int block_level,
                                          const int n_merges_to_make,
@@ -88,11 +94,24 @@ inline Block_Mergers agglomerative_merge(Network* net,
                                          const bool allow_exhaustive = true)
 {
   // Set to keep track of the attepted merge pairs
-  auto checked_pairs = Ordered_Pair_Set<Node*>();
+  auto checked_pairs = Ordered_Pair_Set<Node*, Creation_Order>();
 
   // Priority queue to keep track of best moves
   Best_Move_Queue best_merges;
 
+  // Few enough blocks left that a dense count matrix is cheaper than the
+  // blocks' count maps
+  const bool use_dense = net->n_nodes_at_level(block_level) <= DENSE_BLOCK_THRESHOLD;
+  const Dense_Block_Counts dense_counts = use_dense
+      ? Dense_Block_Counts(net->get_flat_level(block_level))
+      : Dense_Block_Counts();
+
+  auto get_merge_delta = [&](const Node_Pair& merge_pair) {
+    return use_dense
+        ? dense_counts.merge_entropy_delta(merge_pair.first(), merge_pair.second())
+        : merge_entropy_delta(merge_pair);
+  };
+
   for (int type = 0; type < net->n_types(); type++) {
     const auto& blocks_of_type = net->get_nodes_of_type(type, block_level);
     const int n_blocks_of_type = blocks_of_type.size();
@@ -111,7 +130,7 @@ inline Block_Mergers agglomerative_merge(Network* net,
         for (int j = i + 1; j < n_blocks_of_type; j++) {
           const auto merge_pair = Node_Pair(block_i, blocks_of_type.at(j).get());
 
-          best_merges.push(std::make_pair(-merge_entropy_delta(merge_pair), merge_pair));
+          best_merges.push(std::make_pair(-get_merge_delta(merge_pair), merge_pair));
         }
       }
     } else {
@@ -120,7 +139,7 @@ inline Block_Mergers agglomerative_merge(Network* net,
         const auto block_i = block.get();
 
         for (int i = 0; i < n_checks_per_block; i++) {
-          Node* block_j = net->propose_merge(block_i, eps);
+          Node* block_j = net->template propose_move<Layout>(block_i, block_level, eps);
 
           // Ignore if proposal if it's just the block itself
           if (block_i == block_j) continue;
@@ -132,7 +151,7 @@ inline Block_Mergers agglomerative_merge(Network* net,
           if (pair_already_checked) continue;
 
           // Calculate entropy delta for merge and place into results queue.
-          best_merges.push(std::make_pair(-merge_entropy_delta(merge_pair), merge_pair));
+          best_merges.push(std::make_pair(-get_merge_delta(merge_pair), merge_pair));
         } // End of m merge checks
       }   // End of loop over nodes of a type
     }
@@ -151,7 +170,7 @@ inline Block_Mergers agglomerative_merge(Network* net,
   while (merges_to_make.size() < n_merges_to_make) {
 
     if (best_merges.size() == 0) {
-      WARN_ABOUT("Ran of merges during agglomerative merging step. Try raising num_block_proposals and/or lowering sigma.");
+      results.ran_out_of_merges = true;
       break;
     }
     // Extract best remaining merge and remove from queue
@@ -187,4 +206,18 @@ inline Block_Mergers agglomerative_merge(Network* net,
   }
 
   return results;
-}
\ No newline at end of file
+}
+
+// Picks the merge code compiled for the network's type layout
+template <typename Network>
+inline Block_Mergers agglomerative_merge(Network* net,
+                                         const int block_level,
+                                         const int n_merges_to_make,
+                                         const int n_checks_per_block,
+                                         const double& eps,
+                                         const bool allow_exhaustive = true)
+{
+  return net->type_layout() == single_neighbor_type
+      ? agglomerative_merge<single_neighbor_type>(net, block_level, n_merges_to_make, n_checks_per_block, eps, allow_exhaustive)
+      : agglomerative_merge<mixed_neighbor_types>(net, block_level, n_merges_to_make, n_checks_per_block, eps, allow_exhaustive);
+}
@@ -0,0 +1,175 @@
+#pragma once
+
+#include "error_and_message_macros.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <type_traits>
+#include <vector>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#endif
+
+// =============================================================================
+// Binary checkpoint files
+// =============================================================================
+// Plain sequential reads and writes for the checkpoints long sweeps and
+// collapses leave behind (see SBM::set_checkpoint()). Numbers are written as
+// raw bytes so a file is only meant to be read back on the same kind of
+// machine that wrote it. Strings and vectors are prefixed by their length.
+
+// Bumped whenever the layout of a checkpoint changes
+const int CHECKPOINT_VERSION    = 1;
+const char CHECKPOINT_MAGIC[]   = "SBMRCKPT";
+const int CHECKPOINT_MAGIC_SIZE = sizeof(CHECKPOINT_MAGIC) - 1;
+
+// Writes go to a temporary file next to the checkpoint that only replaces it
+// once complete, so being stopped part way through a write leaves the last
+// good checkpoint in place.
+class Checkpoint_Writer {
+  private:
+  std::string path;
+  std::string temp_path;
+  std::ofstream out;
+
+  public:
+  Checkpoint_Writer(const std::string& file_path)
+      : path(file_path)
+      , temp_path(file_path + ".tmp")
+      , out(temp_path, std::ios::binary | std::ios::trunc)
+  {
+    if (!out) LOGIC_ERROR("Can't open checkpoint file " + temp_path + " for writing");
+    out.write(CHECKPOINT_MAGIC, CHECKPOINT_MAGIC_SIZE);
+    write(CHECKPOINT_VERSION);
+  }
+
+  template <typename T>
+  void write(const T& value)
+  {
+    static_assert(std::is_arithmetic<T>::value, "Only numbers are written as raw bytes");
+    out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+  }
+
+  void write(const std::string& value)
+  {
+    write(int(value.size()));
+    out.write(value.data(), value.size());
+  }
+
+  void write(const std::vector<bool>& values)
+  {
+    write(int(values.size()));
+    for (const bool value : values) write(char(value));
+  }
+
+  template <typename T>
+  void write(const std::vector<T>& values)
+  {
+    write(int(values.size()));
+    for (const auto& value : values) write(value);
+  }
+
+  // Swap the finished file in for the last checkpoint. Windows' rename()
+  // refuses to replace an existing file so it gets asked to explicitly.
+  void commit()
+  {
+    out.close();
+    if (!out) LOGIC_ERROR("Failed writing checkpoint file " + temp_path);
+#ifdef _WIN32
+    const bool moved = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    const bool moved = std::rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+    if (!moved) LOGIC_ERROR("Can't move finished checkpoint to " + path);
+  }
+};
+
+class Checkpoint_Reader {
+  private:
+  std::string path;
+  std::ifstream in;
+
+  void check_read()
+  {
+    if (!in) LOGIC_ERROR("Checkpoint file " + path + " ended early. It may be corrupt.");
+  }
+
+  public:
+  Checkpoint_Reader(const std::string& file_path)
+      : path(file_path)
+      , in(file_path, std::ios::binary)
+  {
+    if (!in) LOGIC_ERROR("Can't open checkpoint file " + path);
+
+    char magic[CHECKPOINT_MAGIC_SIZE];
+    in.read(magic, CHECKPOINT_MAGIC_SIZE);
+    if (!in || std::string(magic, CHECKPOINT_MAGIC_SIZE) != CHECKPOINT_MAGIC) {
+      LOGIC_ERROR(path + " is not a checkpoint file");
+    }
+
+    const int version = read<int>();
+    if (version != CHECKPOINT_VERSION) {
+      LOGIC_ERROR("Checkpoint file " + path + " is version " + std::to_string(version)
+                  + " but this version of the package reads version " + std::to_string(CHECKPOINT_VERSION));
+    }
+  }
+
+  template <typename T>
+  T read()
+  {
+    T value;
+    read_into(value);
+    return value;
+  }
+
+  template <typename T>
+  void read_into(T& value)
+  {
+    static_assert(std::is_arithmetic<T>::value, "Only numbers are read as raw bytes");
+    in.read(reinterpret_cast<char*>(&value), sizeof(T));
+    check_read();
+  }
+
+  void read_into(std::string& value)
+  {
+    value.resize(read_size());
+    in.read(&value[0], value.size());
+    check_read();
+  }
+
+  void read_into(std::vector<bool>& values)
+  {
+    values.resize(read_size());
+    for (int i = 0; i < values.size(); i++) values[i] = read<char>();
+  }
+
+  template <typename T>
+  void read_into(std::vector<T>& values)
+  {
+    values.resize(read_size());
+    for (auto& value : values) read_into(value);
+  }
+
+  // Count of things that follow
+  int read_size()
+  {
+    const int size = read<int>();
+    if (size < 0) LOGIC_ERROR("Checkpoint file " + path + " is corrupt");
+    return size;
+  }
+};
+
+// What kind of run ("sweep" or "collapse") a checkpoint is from
+inline std::string checkpoint_kind(const std::string& path)
+{
+  Checkpoint_Reader in(path);
+  return in.read<std::string>();
+}
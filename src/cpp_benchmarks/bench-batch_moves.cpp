@@ -0,0 +1,32 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../SBM.h"
+#include "../cpp_tests/build_testing_networks.h"
+#include "../cpp_tests/catch.hpp"
+
+// Scoring a node against every block, one call per block vs one batch
+TEST_CASE("Batch move scoring", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(8, 250, 0.04, 0.004);
+  my_sbm.initialize_blocks(64);
+
+  const auto nodes  = my_sbm.get_flat_level(0);
+  const auto blocks = my_sbm.get_flat_level(1);
+
+  BENCHMARK("Score 100 nodes against all blocks - one at a time")
+  {
+    double total = 0;
+    for (int i = 0; i < 100; i++) {
+      for (const Node* block : blocks) total += get_move_results(nodes[i], block, 64, 0.1).entropy_delta;
+    }
+    return total;
+  };
+
+  BENCHMARK("Score 100 nodes against all blocks - batched")
+  {
+    double total = 0;
+    for (int i = 0; i < 100; i++) {
+      for (const auto& res : get_move_results(nodes[i], blocks, 64, 0.1)) total += res.entropy_delta;
+    }
+    return total;
+  };
+}
@@ -0,0 +1,69 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../SBM.h"
+#include "../cpp_tests/build_testing_networks.h"
+#include "../cpp_tests/catch.hpp"
+
+// Map based vs dense scoring of moves and merges at a few block counts. The
+// crossover sets DENSE_BLOCK_THRESHOLD.
+TEST_CASE("Dense vs map block counts", "[Dense]")
+{
+  OUT_MSG << "Dense kernel: " << dense_row_kernel_name() << std::endl;
+
+  for (const int n_blocks : { 32, 128, 256, 512 }) {
+    auto my_sbm = planted_unipartite(8, 250, 0.04, 0.004);
+    my_sbm.initialize_blocks(n_blocks);
+
+    const auto nodes  = my_sbm.get_flat_level(0);
+    const auto blocks = my_sbm.get_flat_level(1);
+    const Dense_Block_Counts built_counts(blocks);
+
+    // Same fixed set of proposals for both backends
+    Sampler sampler(42);
+    std::vector<std::pair<Node*, Node*>> moves;
+    for (int i = 0; i < 1000; i++) moves.emplace_back(sampler.sample(nodes), sampler.sample(blocks));
+
+    const string B = " - B = " + as_str(n_blocks);
+
+    BENCHMARK("Score 1000 moves, maps" + B)
+    {
+      double total = 0;
+      for (const auto& move : moves) total += get_move_results(move.first, move.second, n_blocks, 0.1).entropy_delta;
+      return total;
+    };
+
+    BENCHMARK("Score 1000 moves, dense" + B)
+    {
+      Dense_Block_Counts dense_counts = built_counts;
+      double total = 0;
+      for (const auto& move : moves) total += dense_counts.move_results(move.first, move.second, n_blocks, 0.1).entropy_delta;
+      return total;
+    };
+
+    BENCHMARK("Build dense counts" + B)
+    {
+      return Dense_Block_Counts(blocks).n_blocks();
+    };
+
+    BENCHMARK("Score merges of first 16 blocks, maps" + B)
+    {
+      double total = 0;
+      for (int i = 0; i < 16; i++) {
+        for (const auto& block_j : blocks) {
+          if (blocks[i] != block_j) total += merge_entropy_delta(Node_Pair(blocks[i], block_j));
+        }
+      }
+      return total;
+    };
+
+    BENCHMARK("Score merges of first 16 blocks, dense" + B)
+    {
+      double total = 0;
+      for (int i = 0; i < 16; i++) {
+        for (const auto& block_j : blocks) {
+          if (blocks[i] != block_j) total += built_counts.merge_entropy_delta(blocks[i], block_j);
+        }
+      }
+      return total;
+    };
+  }
+}
@@ -0,0 +1,31 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../SBM.h"
+#include "../cpp_tests/build_testing_networks.h"
+#include "../cpp_tests/catch.hpp"
+
+// Metropolis-Hastings vs heat-bath sweeps on a fit that has mostly settled,
+// where MH rejects nearly every proposal. Compare time per sweep against the
+// number of moves each makes.
+TEST_CASE("Heat-bath vs Metropolis-Hastings sweeps", "[SBM]")
+{
+  auto settled_sbm = planted_unipartite(8, 100, 0.1, 0.005);
+  settled_sbm.initialize_blocks(8);
+  settled_sbm.mcmc_sweep(20, 0.1, false, false, 0, false, true);
+
+  const auto settled_state = settled_sbm.compact_state();
+
+  for (const bool heat_bath : { false, true }) {
+    auto my_sbm = planted_unipartite(8, 100, 0.1, 0.005);
+    my_sbm.initialize_blocks(8);
+    my_sbm.update_state(settled_state);
+
+    const auto sweep_res = my_sbm.mcmc_sweep(5, 0.1, false, false, 0, false, heat_bath);
+    OUT_MSG << (heat_bath ? "Heat-bath" : "Metropolis-Hastings")
+            << " moves per sweep: " << sweep_res.nodes_moved.size() / 5.0 << std::endl;
+
+    BENCHMARK(heat_bath ? "Heat-bath sweep" : "Metropolis-Hastings sweep")
+    {
+      return my_sbm.mcmc_sweep(1, 0.1, false, false, 0, false, heat_bath).entropy_delta;
+    };
+  }
+}
@@ -0,0 +1,87 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../simulate_network.h"
+#include "../cpp_tests/catch.hpp"
+
+// Sparse planted network already sitting in its true blocks
+inline SBM fitted_sparse_network(const int n_groups, const int n_per_group, Simulated_Network& network)
+{
+  std::vector<string> names;
+  std::vector<int> sizes, block_a, block_b;
+  std::vector<double> props;
+  for (int r = 0; r < n_groups; r++) {
+    names.push_back("g" + as_str(r));
+    sizes.push_back(n_per_group);
+    for (int s = r; s < n_groups; s++) {
+      block_a.push_back(r);
+      block_b.push_back(s);
+      props.push_back(r == s ? 8.0 / n_per_group : 2.0 / (n_groups * n_per_group));
+    }
+  }
+
+  Sampler sampler(42);
+  network = simulate_sbm(names, sizes, block_a, block_b, props, bernoulli_edges, false, sampler);
+
+  SBM my_sbm { { "node" }, 42 };
+  InOut_String_Vec types, parents;
+  InOut_Int_Vec levels;
+  for (int i = 0; i < network.node_ids.size(); i++) {
+    my_sbm.add_node(network.node_ids[i], "node");
+    types.push_back("node");
+    parents.push_back(names[network.node_blocks[i]]);
+    levels.push_back(0);
+  }
+  for (int e = 0; e < network.n_edges.size(); e++) {
+    my_sbm.add_edge(network.node_ids[network.edges_a[e]], network.node_ids[network.edges_b[e]]);
+  }
+  my_sbm.update_state(network.node_ids, types, parents, levels);
+  return my_sbm;
+}
+
+// A batch of new data: 100 nodes with eight edges each into one group, the
+// way a day of new activity would arrive. Each run adds its own batch so the
+// network grows a little as the benchmark goes.
+inline void add_new_batch(SBM& my_sbm, const Simulated_Network& network, const int n_per_group, Sampler& sampler, int& n_added)
+{
+  const int n_groups = network.node_ids.size() / n_per_group;
+  for (int i = 0; i < 100; i++) {
+    const string id = "new" + as_str(n_added++);
+    const int group = sampler.get_rand_int(n_groups - 1);
+    my_sbm.add_node(id, "node");
+    for (int e = 0; e < 8; e++) {
+      my_sbm.add_edge(id, network.node_ids[group * n_per_group + sampler.get_rand_int(n_per_group - 1)]);
+    }
+  }
+}
+
+TEST_CASE("Taking in new nodes on a fitted model", "[SBM]")
+{
+  const int n_groups = 20, n_per_group = 2500;
+
+  SECTION("Placed and refined locally")
+  {
+    Simulated_Network network;
+    auto my_sbm = fitted_sparse_network(n_groups, n_per_group, network);
+    Sampler sampler(312);
+    int n_added = 0;
+
+    BENCHMARK("Place 100 new nodes and sweep around them twice, 50k nodes")
+    {
+      add_new_batch(my_sbm, network, n_per_group, sampler, n_added);
+      return my_sbm.place_new_nodes(2, 0.1).entropy_delta;
+    };
+  }
+
+  SECTION("Full sweeps")
+  {
+    Simulated_Network network;
+    auto my_sbm = fitted_sparse_network(n_groups, n_per_group, network);
+    Sampler sampler(312);
+    int n_added = 0;
+
+    BENCHMARK("Take in 100 new nodes with two full sweeps, 50k nodes")
+    {
+      add_new_batch(my_sbm, network, n_per_group, sampler, n_added);
+      return my_sbm.mcmc_sweep(2, 0.1, false, false).entropy_delta;
+    };
+  }
+}
@@ -0,0 +1,62 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../SBM.h"
+#include "../cpp_tests/catch.hpp"
+
+#include <functional>
+
+// Neighbor visiting the way it was done before visitors were templated. Kept
+// here so the two can be compared.
+inline void for_all_neighbors_type_erased(const Node* node,
+                                          std::function<void(const Node*, int)> fn)
+{
+  for (const auto& neighbor : node->neighbors()) fn(neighbor.node, neighbor.weight);
+}
+
+// Hub node connected to every other node in a network that has been split
+// into blocks
+inline SBM hub_network(const int n_nodes, const int n_blocks)
+{
+  SBM my_sbm { { "node" }, 42 };
+
+  my_sbm.add_node("hub", "node");
+  for (int i = 0; i < n_nodes; i++) {
+    my_sbm.add_node("n" + as_str(i), "node");
+    my_sbm.add_edge("hub", "n" + as_str(i));
+  }
+
+  my_sbm.initialize_blocks(n_blocks);
+
+  return my_sbm;
+}
+
+TEST_CASE("Neighbor iteration on high degree node", "[Node]")
+{
+  auto my_sbm     = hub_network(20000, 100);
+  const Node* hub = my_sbm.get_node_by_id("hub");
+
+  BENCHMARK("Sum neighbor degrees - std::function")
+  {
+    int total = 0;
+    for_all_neighbors_type_erased(hub, [&](const Node* n, const int weight) { total += n->degree(); });
+    return total;
+  };
+
+  BENCHMARK("Sum neighbor degrees - templated visitor")
+  {
+    int total = 0;
+    hub->for_all_neighbors([&](const Node* n, const int weight) { total += n->degree(); });
+    return total;
+  };
+
+  BENCHMARK("Gather block counts - std::function")
+  {
+    Edge_Count_Map counts;
+    for_all_neighbors_type_erased(hub, [&](const Node* n, const int weight) { counts[n->parent_at_level(1)] += weight; });
+    return counts.size();
+  };
+
+  BENCHMARK("Gather block counts - gather_neighbors_at_level")
+  {
+    return hub->gather_neighbors_at_level(1).size();
+  };
+}
@@ -0,0 +1,60 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../simulate_network.h"
+#include "../cpp_tests/catch.hpp"
+
+// Large sparse planted network with nodes added in a random order, like data
+// coming in from an arbitrary edge list
+inline SBM scrambled_sparse_network(const int n_groups, const int n_per_group, const string& order, const int chunk_size)
+{
+  std::vector<string> names;
+  std::vector<int> sizes, block_a, block_b;
+  std::vector<double> props;
+  for (int r = 0; r < n_groups; r++) {
+    names.push_back("g" + as_str(r));
+    sizes.push_back(n_per_group);
+    for (int s = r; s < n_groups; s++) {
+      block_a.push_back(r);
+      block_b.push_back(s);
+      props.push_back(r == s ? 8.0 / n_per_group : 2.0 / (n_groups * n_per_group));
+    }
+  }
+
+  Sampler sampler(42);
+  const auto network = simulate_sbm(names, sizes, block_a, block_b, props, bernoulli_edges, false, sampler);
+
+  std::vector<int> node_order(network.node_ids.size());
+  std::iota(node_order.begin(), node_order.end(), 0);
+  sampler.shuffle(node_order);
+
+  SBM my_sbm { { "node" }, 42 };
+  for (const int i : node_order) my_sbm.add_node(network.node_ids[i], "node");
+  for (int e = 0; e < network.n_edges.size(); e++) {
+    my_sbm.add_edge(network.node_ids[network.edges_a[e]], network.node_ids[network.edges_b[e]]);
+  }
+
+  if (!order.empty()) my_sbm.reorder_nodes(order, chunk_size);
+  my_sbm.initialize_blocks(n_groups);
+  return my_sbm;
+}
+
+TEST_CASE("Sweeps on large sparse networks by node order", "[SBM]")
+{
+  // 200k nodes with an average degree around ten
+  const int n_groups = 40, n_per_group = 5000;
+
+  struct Layout {
+    string name, order;
+    int chunk_size;
+  };
+  for (const auto& layout : { Layout { "load order", "", 1 },
+                              Layout { "rcm", "rcm", 1 },
+                              Layout { "rcm, chunked sweep", "rcm", 256 },
+                              Layout { "degree, chunked sweep", "degree", 256 } }) {
+    auto my_sbm = scrambled_sparse_network(n_groups, n_per_group, layout.order, layout.chunk_size);
+
+    BENCHMARK("MCMC sweep, 200k nodes - " + layout.name)
+    {
+      return my_sbm.mcmc_sweep(1, 0.1, false, false, 0).entropy_delta;
+    };
+  }
+}
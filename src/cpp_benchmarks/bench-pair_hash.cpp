@@ -0,0 +1,64 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../SBM.h"
+#include "../cpp_tests/build_testing_networks.h"
+#include "../cpp_tests/catch.hpp"
+
+// The hash Ordered_Pair_Hash used to have
+struct Xor_Pair_Hash {
+  size_t operator()(const Const_Node_Pair& p) const
+  {
+    return std::hash<const Node*>()(p.first()) ^ std::hash<const Node*>()(p.second());
+  }
+};
+
+// Build a block pair count map then look every pair up, the access pattern of
+// interblock_edge_counts() and the merge bookkeeping
+template <typename Map>
+long build_and_query(const std::vector<std::pair<Const_Node_Pair, int>>& pairs)
+{
+  Map counts;
+  for (const auto& pair : pairs) counts.emplace(pair.first, pair.second);
+
+  long total = 0;
+  for (int rep = 0; rep < 4; rep++) {
+    for (const auto& pair : pairs) total += counts.find(pair.first)->second;
+  }
+  return total;
+}
+
+TEST_CASE("Pair hash maps", "[Ordered_Pair]")
+{
+  for (const int n_blocks : { 64, 256 }) {
+    auto my_sbm = planted_unipartite(8, 250, 0.04, 0.004);
+    my_sbm.initialize_blocks(n_blocks);
+
+    std::vector<std::pair<Const_Node_Pair, int>> pairs;
+    for (const Node* block : my_sbm.get_flat_level(1)) {
+      for (const auto& block_count : block->block_edges()) {
+        if (block <= block_count.first) pairs.emplace_back(Const_Node_Pair(block, block_count.first), block_count.second);
+      }
+    }
+
+    const string B = " - B = " + as_str(n_blocks) + ", " + as_str(pairs.size()) + " pairs";
+
+    BENCHMARK("std::unordered_map, xor hash" + B)
+    {
+      return build_and_query<std::unordered_map<Const_Node_Pair, int, Xor_Pair_Hash>>(pairs);
+    };
+
+    BENCHMARK("std::unordered_map, mixed hash" + B)
+    {
+      return build_and_query<std::unordered_map<Const_Node_Pair, int, Ordered_Pair_Hash<const Node*>>>(pairs);
+    };
+
+    BENCHMARK("Flat_Hash_Map, mixed hash" + B)
+    {
+      return build_and_query<Flat_Hash_Map<Const_Node_Pair, int, Ordered_Pair_Hash<const Node*>>>(pairs);
+    };
+
+    BENCHMARK("interblock_edge_counts()" + B)
+    {
+      return my_sbm.interblock_edge_counts(1).size();
+    };
+  }
+}
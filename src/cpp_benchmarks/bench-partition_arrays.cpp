@@ -0,0 +1,77 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../simulate_network.h"
+#include "../cpp_tests/catch.hpp"
+
+TEST_CASE("Sweep reads from partition arrays", "[SBM]")
+{
+  Sampler sampler(42);
+  const auto network = simulate_sbm({ "a", "b", "c", "d" },
+                                    { 5000, 5000, 5000, 5000 },
+                                    { 0, 1, 2, 3, 0, 1, 2 },
+                                    { 0, 1, 2, 3, 1, 2, 3 },
+                                    { 0.002, 0.002, 0.002, 0.002, 0.0002, 0.0002, 0.0002 },
+                                    bernoulli_edges,
+                                    false,
+                                    sampler);
+  auto my_sbm = simulated_sbm(network);
+  my_sbm.initialize_blocks(20);
+
+  // Nodes in random order like a sweep visits them
+  auto nodes = my_sbm.get_flat_level(0);
+  sampler.shuffle(nodes);
+
+  Partition_Arrays partition(my_sbm.get_flat_level(0), my_sbm.get_flat_level(1), 1);
+  Dense_Block_Counts dense_counts(partition.blocks());
+  const int n_possible = my_sbm.n_possible_neighbor_blocks(nodes[0]);
+
+  std::vector<double> draws;
+  sampler.fill_unif(draws, n_move_draws * nodes.size());
+
+  BENCHMARK("Propose and score through nodes")
+  {
+    double total = 0;
+    for (int i = 0; i < nodes.size(); i++) {
+      Node* node      = nodes[i];
+      Node* new_block = my_sbm.propose_move<single_neighbor_type>(node, 1, 0.1, &draws[n_move_draws * i]);
+      total += dense_counts.move_results(node, new_block, n_possible).prob_of_accept;
+    }
+    return total;
+  };
+
+  BENCHMARK("Propose and score through partition arrays")
+  {
+    double total = 0;
+    for (int i = 0; i < nodes.size(); i++) {
+      const int array_i   = partition.index(nodes[i]);
+      const int new_block = my_sbm.propose_move<single_neighbor_type>(partition, dense_counts, array_i, 0.1, &draws[n_move_draws * i]);
+      total += dense_counts.move_results(partition, array_i, new_block, n_possible).prob_of_accept;
+    }
+    return total;
+  };
+
+  BENCHMARK("Building the arrays")
+  {
+    return Partition_Arrays(my_sbm.get_flat_level(0), my_sbm.get_flat_level(1), 1).n_nodes();
+  };
+}
+
+TEST_CASE("Fixed block sweeps over partition arrays", "[SBM]")
+{
+  Sampler sampler(42);
+  const auto network = simulate_sbm({ "a", "b", "c", "d" },
+                                    { 5000, 5000, 5000, 5000 },
+                                    { 0, 1, 2, 3, 0, 1, 2 },
+                                    { 0, 1, 2, 3, 1, 2, 3 },
+                                    { 0.002, 0.002, 0.002, 0.002, 0.0002, 0.0002, 0.0002 },
+                                    bernoulli_edges,
+                                    false,
+                                    sampler);
+  auto my_sbm = simulated_sbm(network);
+  my_sbm.initialize_blocks(4);
+
+  // Accepted moves reach the Node objects in one write back per sweep
+  BENCHMARK("Ten sweeps")
+  {
+    return my_sbm.mcmc_sweep(10, 0.1, false, false, 0).entropy_delta;
+  };
+}
@@ -0,0 +1,59 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../simulate_network.h"
+#include "../cpp_tests/catch.hpp"
+
+TEST_CASE("Random draws for a sweep", "[Sampler]")
+{
+  // Draws needed for one sweep over 100k nodes
+  const int n_nodes = 100000;
+  Sampler sampler(42);
+
+  BENCHMARK("One draw at a time")
+  {
+    // What proposals used to do: two integer draws, each building a
+    // distribution, and two uniform draws
+    double total = 0;
+    for (int i = 0; i < n_nodes; i++) {
+      total += sampler.get_rand_int(40);
+      total += sampler.draw_unif();
+      total += sampler.get_rand_int(100);
+      total += sampler.draw_unif();
+    }
+    return total;
+  };
+
+  std::vector<double> draws;
+  BENCHMARK("Batched draws")
+  {
+    sampler.fill_unif(draws, n_move_draws * n_nodes);
+    double total = 0;
+    for (int i = 0; i < n_nodes; i++) {
+      const double* node_draws = &draws[n_move_draws * i];
+      total += Sampler::unif_to_int(node_draws[neighbor_edge_draw], 40);
+      total += node_draws[random_block_draw];
+      total += Sampler::unif_to_int(node_draws[block_draw], 100);
+      total += node_draws[accept_draw];
+    }
+    return total;
+  };
+}
+
+TEST_CASE("Sweeps with batched draws", "[SBM]")
+{
+  Sampler sampler(42);
+  const auto network = simulate_sbm({ "a", "b", "c", "d" },
+                                    { 5000, 5000, 5000, 5000 },
+                                    { 0, 1, 2, 3, 0, 1, 2 },
+                                    { 0, 1, 2, 3, 1, 2, 3 },
+                                    { 0.002, 0.002, 0.002, 0.002, 0.0002, 0.0002, 0.0002 },
+                                    bernoulli_edges,
+                                    false,
+                                    sampler);
+  auto my_sbm = simulated_sbm(network);
+  my_sbm.initialize_blocks(4);
+
+  BENCHMARK("MCMC sweep")
+  {
+    return my_sbm.mcmc_sweep(1, 0.1, false, false, 0).entropy_delta;
+  };
+}
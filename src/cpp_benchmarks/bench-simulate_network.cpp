@@ -0,0 +1,79 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../simulate_network.h"
+#include "../cpp_tests/catch.hpp"
+
+// The old approach: one draw for every pair of nodes
+inline int all_pairs_simulation(const int n_blocks, const int n_per_block, const double p_in, const double p_out)
+{
+  std::mt19937 generator(42);
+  std::bernoulli_distribution in_block(p_in), out_block(p_out);
+
+  const int n_nodes = n_blocks * n_per_block;
+  int n_edges       = 0;
+  for (int i = 0; i < n_nodes; i++) {
+    for (int j = i + 1; j < n_nodes; j++) {
+      n_edges += i / n_per_block == j / n_per_block ? in_block(generator) : out_block(generator);
+    }
+  }
+  return n_edges;
+}
+
+inline Simulated_Network planted_simulation(const int n_blocks,
+                                            const int n_per_block,
+                                            const double p_in,
+                                            const double p_out,
+                                            const Edge_Dist edge_dist)
+{
+  std::vector<string> names;
+  std::vector<int> sizes, block_a, block_b;
+  std::vector<double> props;
+  for (int r = 0; r < n_blocks; r++) {
+    names.push_back("g" + as_str(r));
+    sizes.push_back(n_per_block);
+    for (int s = r; s < n_blocks; s++) {
+      block_a.push_back(r);
+      block_b.push_back(s);
+      props.push_back(r == s ? p_in : p_out);
+    }
+  }
+
+  Sampler sampler(42);
+  return simulate_sbm(names, sizes, block_a, block_b, props, edge_dist, false, sampler);
+}
+
+TEST_CASE("Simulating sparse planted networks", "[Simulation]")
+{
+  // Average degree stays around ten as the network grows
+  for (const int n_per_block : { 200, 2000 }) {
+    const int n_nodes  = 10 * n_per_block;
+    const double p_in  = 8.0 / n_per_block;
+    const double p_out = 2.0 / n_nodes;
+    const string size  = as_str(n_nodes) + " nodes";
+
+    BENCHMARK("All pairs draws, " + size)
+    {
+      return all_pairs_simulation(10, n_per_block, p_in, p_out);
+    };
+
+    BENCHMARK("Block pair draws - bernoulli, " + size)
+    {
+      return planted_simulation(10, n_per_block, p_in, p_out, bernoulli_edges).n_edges.size();
+    };
+
+    BENCHMARK("Block pair draws - poisson, " + size)
+    {
+      return planted_simulation(10, n_per_block, p_in, p_out, poisson_edges).n_edges.size();
+    };
+  }
+
+  BENCHMARK("Block pair draws - poisson, 1000000 nodes")
+  {
+    return planted_simulation(10, 100000, 8.0 / 100000, 2.0 / 1000000, poisson_edges).n_edges.size();
+  };
+
+  const auto network = planted_simulation(10, 2000, 8.0 / 2000, 2.0 / 20000, poisson_edges);
+  BENCHMARK("Load simulated network into model, 20000 nodes")
+  {
+    return simulated_sbm(network).n_edges();
+  };
+}
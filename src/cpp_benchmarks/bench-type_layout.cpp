@@ -0,0 +1,61 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../simulate_network.h"
+#include "../cpp_tests/catch.hpp"
+
+// Planted bipartite network, four blocks of each type
+inline SBM planted_bipartite(const int n_per_block)
+{
+  Sampler sampler(42);
+  const auto network = simulate_sbm({ "u1", "u2", "u3", "u4", "i1", "i2", "i3", "i4" },
+                                    std::vector<int>(8, n_per_block),
+                                    { 0, 0, 1, 1, 2, 2, 3, 3 },
+                                    { 4, 5, 5, 6, 6, 7, 7, 4 },
+                                    { 0.1, 0.01, 0.1, 0.01, 0.1, 0.01, 0.1, 0.01 },
+                                    bernoulli_edges,
+                                    false,
+                                    sampler);
+
+  auto my_sbm = simulated_sbm(network, { "user", "user", "user", "user", "item", "item", "item", "item" });
+  my_sbm.initialize_blocks(40);
+  return my_sbm;
+}
+
+TEST_CASE("Move proposals on a bipartite network", "[SBM]")
+{
+  auto my_sbm       = planted_bipartite(250);
+  const auto nodes  = my_sbm.get_flat_level(0);
+  const auto blocks = my_sbm.get_flat_level(1);
+
+  BENCHMARK("Node proposals - type checked")
+  {
+    int n_moves = 0;
+    for (const auto& node : nodes) n_moves += my_sbm.propose_move<mixed_neighbor_types>(node, 1, 0.1) != node->parent();
+    return n_moves;
+  };
+
+  BENCHMARK("Node proposals - single neighbor type")
+  {
+    int n_moves = 0;
+    for (const auto& node : nodes) n_moves += my_sbm.propose_move<single_neighbor_type>(node, 1, 0.1) != node->parent();
+    return n_moves;
+  };
+
+  BENCHMARK("Merge proposals - type checked")
+  {
+    int n_self = 0;
+    for (const auto& block : blocks) n_self += my_sbm.propose_move<mixed_neighbor_types>(block, 1, 0.1) == block;
+    return n_self;
+  };
+
+  BENCHMARK("Merge proposals - single neighbor type")
+  {
+    int n_self = 0;
+    for (const auto& block : blocks) n_self += my_sbm.propose_move<single_neighbor_type>(block, 1, 0.1) == block;
+    return n_self;
+  };
+
+  BENCHMARK("MCMC sweep")
+  {
+    return my_sbm.mcmc_sweep(1, 0.1, false, false, 0).entropy_delta;
+  };
+}
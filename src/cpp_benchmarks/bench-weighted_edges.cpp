@@ -0,0 +1,52 @@
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../SBM.h"
+#include "../cpp_tests/catch.hpp"
+
+// Planted network where every connected pair carries many repeated edges, the
+// shape of networks built from event logs
+inline SBM repeated_edge_network(const int n_groups,
+                                 const int n_per_group,
+                                 const int n_repeats,
+                                 const bool as_weights)
+{
+  SBM my_sbm { { "node" }, 42 };
+  std::mt19937 generator(42);
+  std::bernoulli_distribution in_group_edge(0.3), out_group_edge(0.02);
+
+  const int n_nodes = n_groups * n_per_group;
+  for (int i = 0; i < n_nodes; i++) my_sbm.add_node("n" + as_str(i), "node");
+
+  for (int i = 0; i < n_nodes; i++) {
+    for (int j = i + 1; j < n_nodes; j++) {
+      const bool same_group = i / n_per_group == j / n_per_group;
+      if (!(same_group ? in_group_edge(generator) : out_group_edge(generator))) continue;
+
+      if (as_weights) {
+        my_sbm.add_edge("n" + as_str(i), "n" + as_str(j), n_repeats);
+      } else {
+        for (int rep = 0; rep < n_repeats; rep++) my_sbm.add_edge("n" + as_str(i), "n" + as_str(j));
+      }
+    }
+  }
+
+  my_sbm.initialize_blocks(n_groups);
+  return my_sbm;
+}
+
+TEST_CASE("Sweeps on networks with repeated edges", "[SBM]")
+{
+  for (const bool as_weights : { false, true }) {
+    auto my_sbm = repeated_edge_network(6, 40, 50, as_weights);
+    const string how = as_weights ? " - weights" : " - repeated add_edge()";
+
+    BENCHMARK("Build network, 50 repeats per pair" + how)
+    {
+      return repeated_edge_network(6, 40, 50, as_weights).n_edges();
+    };
+
+    BENCHMARK("MCMC sweep, 50 repeats per pair" + how)
+    {
+      return my_sbm.mcmc_sweep(1, 0.1, false, false, 0).entropy_delta;
+    };
+  }
+}
@@ -0,0 +1,5 @@
+// Entryway for microbenchmarks. Uses catch's built in benchmarking.
+
+#define CATCH_CONFIG_MAIN
+#define CATCH_CONFIG_ENABLE_BENCHMARKING
+#include "../cpp_tests/catch.hpp"
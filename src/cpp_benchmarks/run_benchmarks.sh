@@ -0,0 +1,35 @@
+echo $PWD
+
+cd src/
+
+echo "=============================================================================\nCompiling Benchmarks..."
+echo "=============================================================================\n"
+
+# Compile the entryway to the benchmarks. This only needs to happen once
+if [ ! -f cpp_benchmarks/benchmarks-main.o ]; then
+  echo "Building benchmark entryway..."
+  g++ -std=c++11 -O2 cpp_benchmarks/benchmarks-main.cpp -c -o cpp_benchmarks/benchmarks-main.o
+fi
+
+# Benchmarks are always built with optimization so timings reflect real use
+g++ -std=c++11 -O2 -DNO_RCPP=1 -pthread\
+  cpp_benchmarks/benchmarks-main.o \
+  cpp_benchmarks/bench-neighbor_iteration.cpp \
+  cpp_benchmarks/bench-dense_block_counts.cpp \
+  cpp_benchmarks/bench-batch_moves.cpp \
+  cpp_benchmarks/bench-heat_bath.cpp \
+  cpp_benchmarks/bench-pair_hash.cpp \
+  cpp_benchmarks/bench-weighted_edges.cpp \
+  cpp_benchmarks/bench-simulate_network.cpp \
+  cpp_benchmarks/bench-type_layout.cpp \
+  cpp_benchmarks/bench-node_order.cpp \
+  cpp_benchmarks/bench-rng_batch.cpp \
+  cpp_benchmarks/bench-incremental_updates.cpp \
+  cpp_benchmarks/bench-partition_arrays.cpp \
+  -o cpp_benchmarks/run_benchmarks.o
+
+
+echo "=============================================================================\nRunning Benchmarks..."
+echo "=============================================================================\n"
+
+./cpp_benchmarks/run_benchmarks.o "$@"
@@ -94,4 +94,32 @@ inline SBM simple_unipartite()
   n6->set_parent(c);
 
   return my_SBM;
-}
\ No newline at end of file
+}
+
+// Unipartite network with nodes split evenly into groups. Nodes in the same
+// group are connected with probability p_in and others with p_out.
+inline SBM planted_unipartite(const int n_groups,
+                              const int nodes_per_group,
+                              const double p_in,
+                              const double p_out,
+                              const int seed = 42)
+{
+  SBM my_sbm { { "node" }, seed };
+
+  std::mt19937 generator(seed);
+  std::uniform_real_distribution<> unif(0, 1);
+
+  const int n_nodes = n_groups * nodes_per_group;
+  for (int i = 0; i < n_nodes; i++) my_sbm.add_node("n" + as_str(i), "node");
+
+  for (int i = 0; i < n_nodes; i++) {
+    for (int j = i + 1; j < n_nodes; j++) {
+      const bool same_group = i / nodes_per_group == j / nodes_per_group;
+      if (unif(generator) < (same_group ? p_in : p_out)) {
+        my_sbm.add_edge("n" + as_str(i), "n" + as_str(j));
+      }
+    }
+  }
+
+  return my_sbm;
+}
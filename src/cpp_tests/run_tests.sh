@@ -17,7 +17,7 @@ fi
 
 
 # Compile all the tests
-g++ -std=c++11 ${OPTIMIZATION_LEVEL} -DNO_RCPP=1\
+g++ -std=c++11 ${OPTIMIZATION_LEVEL} -DNO_RCPP=1 -pthread\
   cpp_tests/tests-main.o \
   cpp_tests/tests-node.cpp \
   cpp_tests/tests-sampler.cpp \
@@ -26,6 +26,15 @@ g++ -std=c++11 ${OPTIMIZATION_LEVEL} -DNO_RCPP=1\
   cpp_tests/tests-mcmc_sweep.cpp \
   cpp_tests/tests-sbm_network_algorithms.cpp \
   cpp_tests/tests-agglomerative_merge.cpp \
+  cpp_tests/tests-replica_exchange.cpp \
+  cpp_tests/tests-nested_sbm.cpp \
+  cpp_tests/tests-dense_block_counts.cpp \
+  cpp_tests/tests-flat_hash_map.cpp \
+  cpp_tests/tests-simulate_network.cpp \
+  cpp_tests/tests-fit_job.cpp \
+  cpp_tests/tests-checkpoint.cpp \
+  cpp_tests/tests-incremental_updates.cpp \
+  cpp_tests/tests-partition_arrays.cpp \
   -o cpp_tests/run_tests.o 
 
 
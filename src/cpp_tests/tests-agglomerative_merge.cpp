@@ -267,4 +267,39 @@ TEST_CASE("Collapse Blocks (w/ MCMC) - Simple Unipartite", "[SBM]")
   // Are our step reporting vectors the correct size?
   REQUIRE(collapse_to_2_res.merge_steps.size() > 1);
   REQUIRE(collapse_to_2_res.states.size() > 1);
-}
\ No newline at end of file
+}
+TEST_CASE("Collapse history can rebuild every step", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(3, 6, 0.6, 0.05);
+
+  auto results = my_sbm.collapse_blocks(0,     // node_level,
+                                        1,     // B_end,
+                                        5,     // n_checks_per_block,
+                                        2,     // n_mcmc_sweeps,
+                                        1.3,   // sigma,
+                                        0.1,   // eps,
+                                        true,  // report all steps,
+                                        true); // Allow exhaustive
+
+  const Collapse_History& history = results.states;
+  REQUIRE(history.size() == results.merge_steps.size());
+
+  // Starts with a block per node
+  REQUIRE(history.initial_state.back().size() == 18);
+
+  // Last step is where the model ended up
+  REQUIRE(history.at(history.size() - 1) == my_sbm.compact_state());
+
+  // Each restored step has the block count recorded for it
+  for (int step = 0; step < history.size(); step++) {
+    my_sbm.update_state(history, step);
+    REQUIRE(my_sbm.n_nodes_at_level(1) == results.merge_steps[step].n_blocks);
+  }
+
+  REQUIRE_THROWS(history.at(history.size()));
+
+  // Only recording the final state still rebuilds it
+  auto final_only = my_sbm.collapse_blocks(0, 3, 5, 0, 1.5, 0.1, false, true);
+  REQUIRE(final_only.states.size() == 1);
+  REQUIRE(final_only.states.at(0) == my_sbm.compact_state());
+}
@@ -0,0 +1,172 @@
+#include "build_testing_networks.h"
+#include "catch.hpp"
+
+#include <cstdio>
+
+const string checkpoint_file = "sbm_checkpoint_test.bin";
+
+// Block each data node sits in, by id
+std::map<string, string> node_blocks(SBM& my_sbm)
+{
+  std::map<string, string> blocks;
+  const State_Dump state = my_sbm.state();
+  for (int i = 0; i < state.ids.size(); i++) {
+    if (state.levels[i] == 0) blocks[state.ids[i]] = state.parents[i];
+  }
+  return blocks;
+}
+
+SBM checkpoint_network()
+{
+  auto my_sbm = planted_unipartite(4, 15, 0.5, 0.05);
+  my_sbm.initialize_blocks(4);
+  return my_sbm;
+}
+
+TEST_CASE("Resumed sweeps match an uninterrupted run", "[SBM]")
+{
+  const int n_sweeps = 8;
+
+  // Variable blocks bring in empty and pooled blocks, fixed blocks with
+  // heat-bath moves go through the dense counts
+  for (const bool variable_blocks : { true, false }) {
+    const bool heat_bath = !variable_blocks;
+
+    auto full_run       = checkpoint_network();
+    const auto full_res = full_run.mcmc_sweep(n_sweeps, 0.1, variable_blocks, true, 0, false, heat_bath);
+
+    // Writing checkpoints doesn't change the run
+    auto checkpointed = checkpoint_network();
+    checkpointed.set_checkpoint(checkpoint_file, 5);
+    const auto checkpointed_res = checkpointed.mcmc_sweep(n_sweeps, 0.1, variable_blocks, true, 0, false, heat_bath);
+    REQUIRE(checkpointed_res.entropy_deltas == full_res.entropy_deltas);
+    REQUIRE(checkpoint_kind(checkpoint_file) == "sweep");
+
+    // A fresh copy of the network picks up after sweep 5
+    auto resumed          = checkpoint_network();
+    const auto resume_res = resumed.resume_sweep(checkpoint_file);
+
+    REQUIRE(resume_res.entropy_deltas == full_res.entropy_deltas);
+    REQUIRE(resume_res.n_nodes_moved == full_res.n_nodes_moved);
+    REQUIRE(resume_res.nodes_moved == full_res.nodes_moved);
+    REQUIRE(resume_res.entropy_delta == full_res.entropy_delta);
+    REQUIRE(node_blocks(resumed) == node_blocks(full_run));
+
+    // Block pairs are summed in creation order, not memory order, so the
+    // entropy matches to the last bit
+    REQUIRE(resumed.entropy(0) == full_run.entropy(0));
+
+    for (const auto& pair : full_res.block_consensus.node_pairs) {
+      REQUIRE(resume_res.block_consensus.node_pairs.at(pair.first).times_connected == pair.second.times_connected);
+    }
+
+    // Both keep sampling the same way afterwards
+    REQUIRE(resumed.mcmc_sweep(2, 0.1, false, false).entropy_deltas
+            == full_run.mcmc_sweep(2, 0.1, false, false).entropy_deltas);
+  }
+
+  std::remove(checkpoint_file.c_str());
+}
+
+TEST_CASE("Resumed collapse matches an uninterrupted run", "[SBM]")
+{
+  // Small sigma so there are plenty of steps to stop between
+  auto full_run       = planted_unipartite(4, 15, 0.5, 0.05);
+  const auto full_res = full_run.collapse_blocks(0, 1, 3, 2, 1.3, 0.1, true, false);
+
+  auto checkpointed = planted_unipartite(4, 15, 0.5, 0.05);
+  checkpointed.set_checkpoint(checkpoint_file, 4);
+  checkpointed.collapse_blocks(0, 1, 3, 2, 1.3, 0.1, true, false);
+  REQUIRE(checkpoint_kind(checkpoint_file) == "collapse");
+
+  auto resumed          = planted_unipartite(4, 15, 0.5, 0.05);
+  const auto resume_res = resumed.resume_collapse(checkpoint_file);
+
+  REQUIRE(resume_res.merge_steps.size() == full_res.merge_steps.size());
+  for (int i = 0; i < full_res.merge_steps.size(); i++) {
+    REQUIRE(resume_res.merge_steps[i].entropy_delta == full_res.merge_steps[i].entropy_delta);
+    REQUIRE(resume_res.merge_steps[i].n_blocks == full_res.merge_steps[i].n_blocks);
+    REQUIRE(resume_res.merge_steps[i].merge_from == full_res.merge_steps[i].merge_from);
+    REQUIRE(resume_res.merge_steps[i].merge_into == full_res.merge_steps[i].merge_into);
+  }
+  REQUIRE(resume_res.entropy_delta == full_res.entropy_delta);
+  REQUIRE(resume_res.final_entropy == full_res.final_entropy);
+  REQUIRE(resume_res.states.initial_state == full_res.states.initial_state);
+  REQUIRE(resume_res.states.moved_nodes == full_res.states.moved_nodes);
+  REQUIRE(resume_res.states.new_blocks == full_res.states.new_blocks);
+  REQUIRE(node_blocks(resumed) == node_blocks(full_run));
+
+  std::remove(checkpoint_file.c_str());
+}
+
+TEST_CASE("Checkpoints only resume on the network and run they came from", "[SBM]")
+{
+  auto my_sbm = checkpoint_network();
+  my_sbm.set_checkpoint(checkpoint_file, 1);
+  my_sbm.mcmc_sweep(3, 0.1, false, false);
+
+  auto other_sbm = checkpoint_network();
+  REQUIRE_THROWS_WITH(other_sbm.resume_collapse(checkpoint_file),
+                      checkpoint_file + " is a checkpoint of sweeps. Use resume_sweep().");
+
+  auto different_network = planted_unipartite(4, 10, 0.5, 0.05);
+  REQUIRE_THROWS_WITH(different_network.resume_sweep(checkpoint_file),
+                      Catch::Contains("different network"));
+
+  std::remove(checkpoint_file.c_str());
+  REQUIRE_THROWS_WITH(other_sbm.resume_sweep(checkpoint_file),
+                      "Can't open checkpoint file " + checkpoint_file);
+
+  REQUIRE_THROWS_WITH(my_sbm.set_checkpoint("", 5), "Checkpoints need a file to be written to.");
+}
+
+TEST_CASE("New checkpoints replace old ones in the same file", "[SBM]")
+{
+  // Sweep checkpoint first
+  auto sweep_sbm = checkpoint_network();
+  sweep_sbm.set_checkpoint(checkpoint_file, 1);
+  sweep_sbm.mcmc_sweep(3, 0.1, false, false);
+  REQUIRE(checkpoint_kind(checkpoint_file) == "sweep");
+
+  // A collapse writing to the same file takes its place
+  auto collapse_sbm = planted_unipartite(4, 15, 0.5, 0.05);
+  collapse_sbm.set_checkpoint(checkpoint_file, 4);
+  collapse_sbm.collapse_blocks(0, 1, 3, 2, 1.3, 0.1, true, false);
+  REQUIRE(checkpoint_kind(checkpoint_file) == "collapse");
+
+  // Nothing half written is left next to it
+  REQUIRE(std::fopen((checkpoint_file + ".tmp").c_str(), "rb") == nullptr);
+
+  auto resumed = planted_unipartite(4, 15, 0.5, 0.05);
+  REQUIRE_NOTHROW(resumed.resume_collapse(checkpoint_file));
+  REQUIRE(node_blocks(resumed) == node_blocks(collapse_sbm));
+
+  std::remove(checkpoint_file.c_str());
+}
+
+TEST_CASE("Entropy is exact after a checkpoint round trip", "[SBM]")
+{
+  // Enough blocks that summing pairs in a different order shows in the last
+  // bits. Resuming frees and reallocates every block so their addresses no
+  // longer follow the order they were created in.
+  const auto network = []() {
+    auto my_sbm = planted_unipartite(4, 15, 0.5, 0.05);
+    my_sbm.initialize_blocks(20);
+    return my_sbm;
+  };
+
+  auto full_run = network();
+  full_run.mcmc_sweep(4, 0.1, false, false);
+
+  auto checkpointed = network();
+  checkpointed.set_checkpoint(checkpoint_file, 2);
+  checkpointed.mcmc_sweep(4, 0.1, false, false);
+  REQUIRE(checkpointed.entropy(0) == full_run.entropy(0));
+
+  auto resumed = network();
+  resumed.resume_sweep(checkpoint_file);
+  REQUIRE(node_blocks(resumed) == node_blocks(full_run));
+  REQUIRE(resumed.entropy(0) == full_run.entropy(0));
+
+  std::remove(checkpoint_file.c_str());
+}
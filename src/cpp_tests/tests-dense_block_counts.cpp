@@ -0,0 +1,128 @@
+#include "../dense_block_counts.h"
+#include "build_testing_networks.h"
+#include "catch.hpp"
+
+TEST_CASE("Dense row kernels agree with scalar loop", "[Dense]")
+{
+  reserve_log_tables(400);
+  const double* table = current_log_tables().load()->n_log_n.data();
+
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> count(0, 190);
+
+  // Odd length so the vector kernels have to handle a tail
+  const int n = 37;
+  std::vector<int> row_a(n), row_b(n);
+  std::vector<double> log_d(n);
+  for (int t = 0; t < n; t++) {
+    row_a[t] = count(generator);
+    row_b[t] = count(generator);
+    log_d[t] = std::log(1.0 + count(generator));
+  }
+
+  std::vector<Row_Kernel> kernels { dense_row_kernel() };
+#ifdef SBMR_DENSE_X86
+  kernels.push_back(row_sums_sse2);
+  if (__builtin_cpu_supports("avx2")) kernels.push_back(row_sums_avx2);
+#endif
+
+  for (const int* second_row : { static_cast<const int*>(nullptr), static_cast<const int*>(row_b.data()) }) {
+    const Row_Sums expected = row_sums_scalar(row_a.data(), second_row, log_d.data(), table, n);
+    for (const auto& kernel : kernels) {
+      const Row_Sums sums = kernel(row_a.data(), second_row, log_d.data(), table, n);
+      REQUIRE(sums.x_log_x == Approx(expected.x_log_x));
+      REQUIRE(sums.x_log_d == Approx(expected.x_log_d));
+      REQUIRE(sums.total == expected.total);
+    }
+  }
+}
+
+TEST_CASE("Dense move results match map based results", "[Dense]")
+{
+  auto my_sbm = planted_unipartite(4, 15, 0.5, 0.05);
+  my_sbm.initialize_blocks(10);
+
+  Sampler sampler(312);
+  auto nodes  = my_sbm.get_flat_level(0);
+  auto blocks = my_sbm.get_flat_level(1);
+
+  Dense_Block_Counts dense_counts(blocks);
+  REQUIRE(dense_counts.n_blocks() == 10);
+
+  for (int i = 0; i < 200; i++) {
+    Node* node      = sampler.sample(nodes);
+    Node* new_block = sampler.sample(blocks);
+    if (node->parent() == new_block) continue;
+
+    const int n_possible = my_sbm.n_possible_neighbor_blocks(node);
+    const auto map_res   = get_move_results(node, new_block, n_possible, 0.1);
+    const auto dense_res = dense_counts.move_results(node, new_block, n_possible, 0.1);
+
+    REQUIRE(dense_res.entropy_delta == Approx(map_res.entropy_delta));
+    REQUIRE(dense_res.prob_ratio == Approx(map_res.prob_ratio));
+
+    // Take every other move so the matrix has to keep up with changes
+    if (i % 2 == 0 && node->parent()->n_children() > 1) {
+      dense_counts.commit_move(node, new_block);
+      node->set_parent(new_block);
+    }
+
+    // Moves other than the last one scored can be committed too
+    Node* other_node = nodes[i % nodes.size()];
+    if (i % 7 == 0 && other_node->parent()->n_children() > 1) {
+      dense_counts.commit_move(other_node, new_block);
+      other_node->set_parent(new_block);
+    }
+  }
+
+  // Committed moves leave the matrix the same as one built fresh
+  const Dense_Block_Counts fresh_counts(blocks);
+  for (const auto& block_a : blocks) {
+    for (const auto& block_b : blocks) {
+      REQUIRE(dense_counts.edges_between(block_a, block_b) == fresh_counts.edges_between(block_a, block_b));
+    }
+  }
+}
+
+TEST_CASE("Dense merge deltas match map based deltas", "[Dense]")
+{
+  auto my_sbm = planted_unipartite(3, 10, 0.6, 0.1);
+  my_sbm.initialize_blocks(8);
+
+  const auto blocks = my_sbm.get_flat_level(1);
+  const Dense_Block_Counts dense_counts(blocks);
+
+  for (int i = 0; i < blocks.size(); i++) {
+    for (int j = i + 1; j < blocks.size(); j++) {
+      const auto merge_pair = Node_Pair(blocks[i], blocks[j]);
+      REQUIRE(dense_counts.merge_entropy_delta(merge_pair.first(), merge_pair.second())
+              == Approx(merge_entropy_delta(merge_pair)));
+    }
+  }
+
+  // Bipartite networks have blocks that never connect to each other
+  auto bipartite_sbm            = simple_bipartite();
+  const auto bipartite_blocks   = bipartite_sbm.get_flat_level(1);
+  const Dense_Block_Counts bi_counts(bipartite_blocks);
+  for (const auto& block_a : bipartite_blocks) {
+    for (const auto& block_b : bipartite_blocks) {
+      if (block_a == block_b || block_a->type() != block_b->type()) continue;
+      const auto merge_pair = Node_Pair(block_a, block_b);
+      REQUIRE(bi_counts.merge_entropy_delta(merge_pair.first(), merge_pair.second())
+              == Approx(merge_entropy_delta(merge_pair)));
+    }
+  }
+}
+
+TEST_CASE("Sweeps on the dense backend track entropy", "[Dense]")
+{
+  auto my_sbm = planted_unipartite(4, 10, 0.5, 0.05);
+  my_sbm.initialize_blocks(6);
+
+  const double pre_entropy = my_sbm.entropy(0);
+  const auto sweep_res     = my_sbm.mcmc_sweep(10, 0.1, false, false, 0);
+
+  REQUIRE(sweep_res.nodes_moved.size() > 0);
+  REQUIRE(my_sbm.n_nodes_at_level(1) == 6);
+  REQUIRE(my_sbm.entropy(0) - pre_entropy == Approx(sweep_res.entropy_delta).margin(1e-6));
+}
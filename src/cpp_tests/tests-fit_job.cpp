@@ -0,0 +1,105 @@
+#include "build_testing_networks.h"
+#include "catch.hpp"
+
+#include <chrono>
+
+TEST_CASE("Sweep job matches sweeping a copy of the model", "[SBM]")
+{
+  auto job_sbm  = simple_unipartite();
+  auto sync_sbm = simple_unipartite();
+
+  job_sbm.start_sweep_job(20, 0.1, false, false, 0, false);
+  REQUIRE(job_sbm.has_job());
+  const auto job_res = job_sbm.collect_sweep_job();
+  REQUIRE_FALSE(job_sbm.has_job());
+
+  // A job runs on a copy seeded from the model's sampler
+  Sampler seeder(42);
+  auto copy           = sync_sbm.clone(seeder.get_rand_int(std::numeric_limits<int>::max() - 1));
+  const auto sync_res = copy->mcmc_sweep(20, 0.1, false, false, 0, false, false);
+
+  REQUIRE(job_res.entropy_deltas == sync_res.entropy_deltas);
+  REQUIRE(job_res.n_nodes_moved == sync_res.n_nodes_moved);
+
+  // Model takes on the job's final state with its block ids
+  REQUIRE(job_sbm.entropy(0) == Approx(copy->entropy(0)));
+  for (const std::string id : { "n1", "n2", "n3", "n4", "n5", "n6" }) {
+    REQUIRE(job_sbm.get_node_by_id(id)->parent()->id() == copy->get_node_by_id(id)->parent()->id());
+  }
+}
+
+TEST_CASE("Cancelled sweep job keeps finished sweeps", "[SBM]")
+{
+  const int n_sweeps = 1000000;
+  auto my_sbm        = planted_unipartite(4, 50, 0.3, 0.05);
+  my_sbm.initialize_blocks(4);
+
+  my_sbm.start_sweep_job(n_sweeps, 0.1, false, false, 0, false);
+  while (my_sbm.job_progress().step < 2) std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  my_sbm.cancel_job();
+
+  while (my_sbm.job_progress().status == "running") std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  const auto progress = my_sbm.job_progress();
+  REQUIRE(progress.status == "cancelled");
+  REQUIRE(progress.n_steps == n_sweeps);
+  REQUIRE(progress.n_blocks == 4);
+  REQUIRE(progress.acceptance_rate >= 0.0);
+  REQUIRE(progress.acceptance_rate <= 1.0);
+
+  const auto results = my_sbm.collect_sweep_job();
+  REQUIRE(results.entropy_deltas.size() == progress.step);
+  REQUIRE(results.entropy_deltas.size() < n_sweeps);
+
+  // Reported entropy tracks the state the model was left in
+  REQUIRE(my_sbm.entropy(0) == Approx(progress.entropy));
+}
+
+TEST_CASE("Collapse job reports each merge step", "[SBM]")
+{
+  auto my_sbm = simple_unipartite();
+
+  my_sbm.start_collapse_job(0, 1, 5, 0, 2.0, 0.1, true, true);
+
+  Job_Progress progress;
+  do {
+    progress = my_sbm.job_progress();
+  } while (progress.status == "running");
+
+  const auto results = my_sbm.collect_collapse_job();
+
+  REQUIRE(progress.kind == "collapse");
+  REQUIRE(progress.status == "finished");
+  REQUIRE(progress.step == results.merge_steps.size());
+  REQUIRE(progress.n_blocks == 1);
+  REQUIRE(progress.entropy == Approx(results.final_entropy));
+  REQUIRE(my_sbm.n_nodes_at_level(1) == 1);
+  REQUIRE(my_sbm.entropy(0) == Approx(results.final_entropy));
+}
+
+TEST_CASE("Background jobs are one at a time and collected by kind", "[SBM]")
+{
+  auto my_sbm = simple_unipartite();
+
+  REQUIRE_THROWS_WITH(my_sbm.job_progress(), "No background job to report on.");
+  REQUIRE_THROWS_WITH(my_sbm.collect_sweep_job(), "No background job to collect.");
+
+  my_sbm.start_sweep_job(5, 0.1, false, false, 0, false);
+  REQUIRE_THROWS_WITH(my_sbm.start_collapse_job(0, 1, 5, 0, 2.0, 0.1, true, true),
+                      "Model already has a background job. Collect it before starting another.");
+  REQUIRE_THROWS_WITH(my_sbm.collect_collapse_job(), "Background job is a sweep job.");
+
+  // Job is still there to be collected properly
+  REQUIRE(my_sbm.collect_sweep_job().entropy_deltas.size() == 5);
+}
+
+TEST_CASE("Errors in a job are thrown when it's collected", "[SBM]")
+{
+  auto my_sbm = simple_unipartite();
+
+  // Model only has two levels. The worker's error keeps its message and only
+  // the worker thread was marked as one.
+  my_sbm.start_sweep_job(5, 0.1, false, false, 5, false);
+  REQUIRE_THROWS_WITH(my_sbm.collect_sweep_job(), "Can't calculate entropy because there is no block structure for nodes");
+  REQUIRE_FALSE(my_sbm.has_job());
+  REQUIRE_FALSE(on_worker_thread());
+}
@@ -0,0 +1,67 @@
+#include "../Ordered_Pair.h"
+#include "catch.hpp"
+#include <map>
+#include <random>
+
+TEST_CASE("Flat hash map matches std::map", "[Flat_Hash_Map]")
+{
+  std::mt19937 generator(42);
+  std::uniform_int_distribution<int> key_dist(0, 500);
+
+  Flat_Hash_Map<int, int> flat_map;
+  std::map<int, int> std_map;
+
+  // Enough inserts to grow the table a few times, with plenty of repeats
+  for (int i = 0; i < 2000; i++) {
+    const int key = key_dist(generator);
+    REQUIRE(flat_map.emplace(key, i).second == std_map.emplace(key, i).second);
+
+    const int other_key = key_dist(generator);
+    flat_map[other_key]++;
+    std_map[other_key]++;
+  }
+
+  REQUIRE(flat_map.size() == std_map.size());
+  for (const auto& entry : std_map) REQUIRE(flat_map.at(entry.first) == entry.second);
+
+  // Iteration sees every entry once
+  std::map<int, int> seen;
+  for (const auto& entry : flat_map) seen[entry.first] += entry.second;
+  REQUIRE(seen == std_map);
+
+  // Missing keys
+  REQUIRE(flat_map.count(-1) == 0);
+  REQUIRE(flat_map.find(-1) == flat_map.end());
+  REQUIRE_THROWS(flat_map.at(-1));
+
+  flat_map.clear();
+  REQUIRE(flat_map.empty());
+  REQUIRE(flat_map.count(std_map.begin()->first) == 0);
+}
+
+TEST_CASE("Ordered pair hash separates pointer pairs", "[Flat_Hash_Map]")
+{
+  std::vector<int> blocks(64);
+  const Ordered_Pair_Hash<const int*> hasher;
+
+  // Xor of the halves sends every (a, a) pair to zero and clusters
+  // neighboring pointers. Mixed hashes should be all distinct here.
+  Flat_Hash_Set<size_t> hashes;
+  std::size_t n_pairs = 0;
+  for (std::size_t i = 0; i < blocks.size(); i++) {
+    for (std::size_t j = i; j < blocks.size(); j++) {
+      hashes.insert(hasher(Ordered_Pair<const int*>(&blocks[i], &blocks[j])));
+      n_pairs++;
+    }
+  }
+  REQUIRE(hashes.size() == n_pairs);
+
+  // Order of the pair doesn't matter
+  REQUIRE(hasher(Ordered_Pair<const int*>(&blocks[3], &blocks[9]))
+          == hasher(Ordered_Pair<const int*>(&blocks[9], &blocks[3])));
+
+  Ordered_Pair_Set<const int*> pair_set;
+  REQUIRE(pair_set.insert(Ordered_Pair<const int*>(&blocks[1], &blocks[2])).second);
+  REQUIRE_FALSE(pair_set.insert(Ordered_Pair<const int*>(&blocks[2], &blocks[1])).second);
+  REQUIRE(pair_set.size() == 1);
+}
@@ -0,0 +1,187 @@
+#include "build_testing_networks.h"
+#include "catch.hpp"
+
+// Degree and edge counts to other blocks of every block at level, by id
+std::map<string, std::map<string, int>> block_structure(const SBM& my_sbm, const int level)
+{
+  std::map<string, std::map<string, int>> structure;
+  for (const Node* block : my_sbm.get_flat_level(level)) {
+    auto& counts     = structure[block->id()];
+    counts["degree"] = block->degree();
+    for (const auto& block_count : block->block_edges()) counts[block_count.first->id()] = block_count.second;
+  }
+  return structure;
+}
+
+string parent_id(const SBM& my_sbm, const string& node_id)
+{
+  return my_sbm.get_node_by_id(node_id)->parent()->id();
+}
+
+TEST_CASE("Nodes and edges added to a fitted model keep block counts current", "[SBM]")
+{
+  // Three groups of ten with a few new nodes and a self edge arriving later
+  std::mt19937 generator(42);
+  std::uniform_real_distribution<> unif(0, 1);
+
+  std::vector<string> ids;
+  for (int i = 0; i < 30; i++) ids.push_back("n" + as_str(i));
+
+  std::vector<std::pair<string, string>> edges;
+  for (int i = 0; i < 30; i++) {
+    for (int j = i + 1; j < 30; j++) {
+      if (unif(generator) < (i / 10 == j / 10 ? 0.5 : 0.05)) edges.emplace_back(ids[i], ids[j]);
+    }
+  }
+  const int n_first = edges.size() * 2 / 3;
+
+  std::vector<std::pair<string, string>> later_edges(edges.begin() + n_first, edges.end());
+  for (int i = 0; i < 6; i++) later_edges.emplace_back("new" + as_str(i % 3), ids[i * 5]);
+  later_edges.emplace_back("new0", "new1");
+  later_edges.emplace_back("n3", "n3");
+
+  // Fit two levels of blocks on the first edges then grow the network
+  SBM grown { { "node" }, 42 };
+  for (const auto& id : ids) grown.add_node(id, "node");
+  for (int i = 0; i < n_first; i++) grown.add_edge(edges[i].first, edges[i].second);
+  grown.initialize_blocks(4);
+  grown.initialize_blocks(2);
+  grown.mcmc_sweep(3, 0.1, false, false);
+
+  for (int i = 0; i < 3; i++) grown.add_node("new" + as_str(i), "node");
+  for (const auto& edge : later_edges) grown.add_edge(edge.first, edge.second);
+  REQUIRE(grown.n_unplaced_nodes() == 3);
+
+  // Same network built all at once and given the grown model's blocks
+  SBM rebuilt { { "node" }, 42 };
+  for (const auto& id : ids) rebuilt.add_node(id, "node");
+  for (int i = 0; i < 3; i++) rebuilt.add_node("new" + as_str(i), "node");
+  for (int i = 0; i < n_first; i++) rebuilt.add_edge(edges[i].first, edges[i].second);
+  for (const auto& edge : later_edges) rebuilt.add_edge(edge.first, edge.second);
+
+  const State_Dump grown_state = grown.state();
+  rebuilt.update_state(grown_state.ids, grown_state.types, grown_state.parents, grown_state.levels);
+
+  REQUIRE(grown.n_edges() == rebuilt.n_edges());
+  REQUIRE(block_structure(grown, 1) == block_structure(rebuilt, 1));
+  REQUIRE(block_structure(grown, 2) == block_structure(rebuilt, 2));
+  REQUIRE(grown.entropy(0) == Approx(rebuilt.entropy(0)));
+  REQUIRE(grown.entropy(1) == Approx(rebuilt.entropy(1)));
+}
+
+TEST_CASE("New nodes are placed with the blocks their edges lead to", "[SBM]")
+{
+  // Three disconnected groups, each already in its own block
+  auto my_sbm = planted_unipartite(3, 10, 0.9, 0.0);
+
+  InOut_String_Vec ids, types, parents;
+  InOut_Int_Vec levels;
+  for (int i = 0; i < 30; i++) {
+    ids.push_back("n" + as_str(i));
+    types.push_back("node");
+    parents.push_back("group" + as_str(i / 10));
+    levels.push_back(0);
+  }
+  my_sbm.update_state(ids, types, parents, levels);
+
+  my_sbm.add_node("new_a", "node");
+  my_sbm.add_node("new_b", "node");
+  my_sbm.add_node("loner", "node");
+  for (int i = 0; i < 5; i++) {
+    my_sbm.add_edge("new_a", "n" + as_str(i));
+    my_sbm.add_edge("new_b", "n" + as_str(20 + i));
+  }
+  REQUIRE(my_sbm.n_unplaced_nodes() == 3);
+
+  // Placement on its own is greedy
+  const double entropy_before = my_sbm.entropy(0);
+  const auto placed           = my_sbm.place_new_nodes(0, 0.1);
+
+  REQUIRE(placed.entropy_deltas.size() == 1);
+  REQUIRE(parent_id(my_sbm, "new_a") == "group0");
+  REQUIRE(parent_id(my_sbm, "new_b") == "group2");
+  REQUIRE(my_sbm.entropy(0) == Approx(entropy_before + placed.entropy_delta));
+
+  // Nodes without edges keep waiting
+  REQUIRE(my_sbm.n_unplaced_nodes() == 1);
+
+  // Refinement sweeps report their moves the same way
+  my_sbm.add_edge("loner", "n15");
+  my_sbm.add_edge("new_a", "n12");
+  const double entropy_placed = my_sbm.entropy(0);
+  const auto refined          = my_sbm.place_new_nodes(5, 0.1);
+
+  REQUIRE(refined.entropy_deltas.size() == 6);
+  REQUIRE(my_sbm.n_unplaced_nodes() == 0);
+  REQUIRE(parent_id(my_sbm, "loner") == "group1");
+  REQUIRE(my_sbm.entropy(0) == Approx(entropy_placed + refined.entropy_delta));
+}
+
+TEST_CASE("New nodes need blocks to be placed into", "[SBM]")
+{
+  SBM my_sbm { { "a" }, 42 };
+  my_sbm.add_node("n1", "a");
+  my_sbm.add_node("n2", "a");
+  my_sbm.add_edge("n1", "n2");
+  REQUIRE_THROWS_WITH(my_sbm.place_new_nodes(1, 0.1), "Model has no blocks to place nodes into. Use initialize_blocks() first.");
+
+  // Without blocks there is nothing to wait on
+  REQUIRE(my_sbm.n_unplaced_nodes() == 0);
+}
+
+TEST_CASE("Warm starts pick up the blocks of an earlier snapshot", "[SBM]")
+{
+  // Three groups of ten, each in its own block
+  auto earlier = planted_unipartite(3, 10, 0.9, 0.0);
+
+  InOut_String_Vec ids, types, parents;
+  InOut_Int_Vec levels;
+  for (int i = 0; i < 30; i++) {
+    ids.push_back("n" + as_str(i));
+    types.push_back("node");
+    parents.push_back("group" + as_str(i / 10));
+    levels.push_back(0);
+  }
+  earlier.update_state(ids, types, parents, levels);
+  earlier.initialize_blocks(1);
+  const State_Dump earlier_state = earlier.state();
+
+  // The last group and n5 are gone from the new snapshot and two new nodes
+  // have shown up in the first two groups
+  SBM later { { "node" }, 42 };
+  for (int i = 0; i < 20; i++) {
+    if (i != 5) later.add_node("n" + as_str(i), "node");
+  }
+  later.add_node("new_a", "node");
+  later.add_node("new_b", "node");
+  for (int i = 0; i < 20; i++) {
+    for (int j = i + 1; j < 20; j++) {
+      if (i != 5 && j != 5 && i / 10 == j / 10) later.add_edge("n" + as_str(i), "n" + as_str(j));
+    }
+  }
+  for (int i = 1; i < 5; i++) {
+    later.add_edge("new_a", "n" + as_str(i));
+    later.add_edge("new_b", "n" + as_str(10 + i));
+  }
+
+  const int n_new = later.warm_start(earlier_state.ids, earlier_state.types, earlier_state.parents, earlier_state.levels, 0.1);
+
+  REQUIRE(n_new == 2);
+  REQUIRE(later.n_unplaced_nodes() == 0);
+
+  // Emptied block is gone and everyone else kept theirs
+  REQUIRE(later.n_nodes_at_level(1) == 2);
+  REQUIRE(later.n_nodes_at_level(2) == 1);
+  for (int i = 0; i < 20; i++) {
+    if (i != 5) REQUIRE(parent_id(later, "n" + as_str(i)) == "group" + as_str(i / 10));
+  }
+
+  // New nodes joined the groups they connect to
+  REQUIRE(parent_id(later, "new_a") == "group0");
+  REQUIRE(parent_id(later, "new_b") == "group1");
+
+  // Starting from the old fit there's nothing left for sweeps to improve
+  const double warm_entropy = later.entropy(0);
+  later.mcmc_sweep(5, 0.1, false, false);
+  REQUIRE(later.entropy(0) >= Approx(warm_entropy));
+}
@@ -85,4 +85,166 @@ TEST_CASE("MCMC sweeps w/ varying epsilon - Simple Unipartite", "[SBM]")
 
   // Make sure that we have a more move-prone model when we have a high epsilon value...
   REQUIRE(avg_n_moves.at(0) < avg_n_moves.at(1));
-}
\ No newline at end of file
+}
+TEST_CASE("Sweeps are reproducible for a seed", "[SBM]")
+{
+  const auto run_sweeps = [](const int seed) {
+    auto my_sbm = planted_unipartite(4, 15, 0.4, 0.05, seed);
+    my_sbm.initialize_blocks(6);
+    return my_sbm.mcmc_sweep(5, 0.1, true, false, 0);
+  };
+
+  const auto res_1 = run_sweeps(42);
+  const auto res_2 = run_sweeps(42);
+  const auto res_3 = run_sweeps(43);
+
+  REQUIRE(res_1.nodes_moved.size() > 0);
+  REQUIRE(res_1.nodes_moved == res_2.nodes_moved);
+  REQUIRE(res_1.entropy_deltas == res_2.entropy_deltas);
+  REQUIRE(res_1.nodes_moved != res_3.nodes_moved);
+}
+
+TEST_CASE("Heat-bath sweeps", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(4, 10, 0.5, 0.03);
+  my_sbm.initialize_blocks(4);
+
+  // Heat-bath draws for a node always land in a block of its type at the
+  // level above
+  Node* node = my_sbm.get_node_by_id("n3");
+  Move_Results drawn_results(0, 1);
+  for (int i = 0; i < 20; i++) {
+    Node* drawn = my_sbm.heat_bath_draw(node, 0.1, 1.0, drawn_results);
+    REQUIRE(drawn->level() == 1);
+    REQUIRE(drawn_results.prob_of_accept == 1.0);
+    if (drawn == node->parent()) REQUIRE(drawn_results.entropy_delta == 0);
+  }
+
+  // Running entropy delta stays exact and the fit improves on the random start
+  const double pre_entropy = my_sbm.entropy(0);
+  const auto fixed_res     = my_sbm.mcmc_sweep(10, 0.1, false, false, 0, false, true);
+
+  REQUIRE(my_sbm.n_nodes_at_level(1) == 4);
+  REQUIRE(fixed_res.nodes_moved.size() > 0);
+  REQUIRE(my_sbm.entropy(0) - pre_entropy == Approx(fixed_res.entropy_delta).margin(1e-6));
+  REQUIRE(fixed_res.entropy_delta < 0);
+
+  // Can also vary the number of blocks through the empty block
+  const double mid_entropy = my_sbm.entropy(0);
+  const auto variable_res  = my_sbm.mcmc_sweep(5, 0.1, true, false, 0, false, true);
+  REQUIRE(my_sbm.entropy(0) - mid_entropy == Approx(variable_res.entropy_delta).margin(1e-6));
+}
+
+TEST_CASE("Merge-split moves change block counts by whole blocks", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(4, 10, 0.6, 0.02);
+
+  // Start with everything in one block
+  my_sbm.initialize_blocks(1);
+  REQUIRE(my_sbm.n_nodes_at_level(1) == 1);
+
+  double pre_entropy = my_sbm.entropy(0);
+  int largest_jump   = 0;
+  for (int i = 0; i < 5; i++) {
+    const int pre_n_blocks = my_sbm.n_nodes_at_level(1);
+    const auto sweep_res   = my_sbm.mcmc_sweep(1, 0.1, true, true, 0);
+
+    // Running entropy delta includes the merge-split moves
+    REQUIRE(my_sbm.entropy(0) - pre_entropy == Approx(sweep_res.entropy_delta).margin(1e-6));
+    pre_entropy = my_sbm.entropy(0);
+
+    largest_jump = std::max(largest_jump, std::abs(my_sbm.n_nodes_at_level(1) - pre_n_blocks));
+
+    // Only the temporary empty block gets cleaned up
+    for (const auto& block : my_sbm.get_nodes_of_type(0, 1)) REQUIRE(!block->is_empty());
+  }
+
+  REQUIRE(my_sbm.n_nodes_at_level(1) > 1);
+  REQUIRE(largest_jump > 1);
+}
+
+TEST_CASE("Empty block registry tracks emptied blocks and reuses deleted ones", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(3, 10, 0.5, 0.05);
+  my_sbm.initialize_blocks(6);
+
+  const auto scanned_empty = [&]() {
+    int n_empty = 0;
+    for (const auto& block : my_sbm.get_nodes_of_type(0, 1)) n_empty += block->is_empty();
+    return n_empty;
+  };
+  REQUIRE(my_sbm.empty_blocks_of_type(0, 1).size() == 0);
+
+  // Blocks join the registry when their last child leaves
+  Node* block     = my_sbm.get_flat_level(1)[0];
+  Node* new_block = my_sbm.get_flat_level(1)[1];
+  const auto children = block->children();
+  for (Node* child : children) child->set_parent(new_block);
+  REQUIRE(my_sbm.empty_blocks_of_type(0, 1).size() == 1);
+  REQUIRE(my_sbm.empty_blocks_of_type(0, 1)[0] == block);
+
+  // ... and leave when they get a child back
+  children[0]->set_parent(block);
+  REQUIRE(my_sbm.empty_blocks_of_type(0, 1).size() == 0);
+  children[0]->set_parent(new_block);
+
+  // Removed blocks are handed back out by add_block_node
+  REQUIRE(my_sbm.remove_empty_blocks(1) == 1);
+  REQUIRE(my_sbm.n_nodes_at_level(1) == 5);
+  Node* added_block = my_sbm.add_block_node(0, 1);
+  REQUIRE(added_block == block);
+  REQUIRE(added_block->parent() == nullptr);
+  REQUIRE(my_sbm.empty_blocks_of_type(0, 1).size() == 1);
+  REQUIRE(my_sbm.n_nodes_at_level(1) == 6);
+
+  // Registry stays in step with a full scan through sweeps and merges
+  for (int i = 0; i < 4; i++) {
+    my_sbm.mcmc_sweep(1, 0.1, true, i % 2, 0);
+    REQUIRE(my_sbm.empty_blocks_of_type(0, 1).size() == scanned_empty());
+  }
+  REQUIRE(scanned_empty() == 0);
+
+  my_sbm.collapse_blocks(0, 2, 3, 0, 1.5, 0.1, false);
+  REQUIRE(my_sbm.empty_blocks_of_type(0, 1).size() == scanned_empty());
+}
+
+TEST_CASE("Sweeping a model without blocks starts from one block per node", "[SBM]")
+{
+  SBM my_sbm { { "n1", "n2", "n3", "n4" }, { "a", "a", "a", "a" }, { "n1", "n2", "n3" }, { "n2", "n3", "n4" }, { "a" } };
+  REQUIRE(my_sbm.n_levels() == 1);
+
+  my_sbm.mcmc_sweep(1, 0.1, false, false);
+  REQUIRE(my_sbm.n_levels() == 2);
+  REQUIRE(my_sbm.get_flat_level(1).size() == 4);
+}
+
+TEST_CASE("Sweeping keeps blocks that have blocks of their own", "[SBM]")
+{
+  auto my_sbm = simple_unipartite();
+  my_sbm.initialize_blocks(1);
+  REQUIRE(my_sbm.n_levels() == 3);
+
+  // Nodes move between the existing three blocks rather than a fresh set
+  my_sbm.mcmc_sweep(5, 0.1, false, false);
+  REQUIRE(my_sbm.n_levels() == 3);
+  REQUIRE(my_sbm.get_flat_level(1).size() == 3);
+}
+
+TEST_CASE("Nodes without edges stay in their block", "[SBM]")
+{
+  SBM my_sbm { { "n1", "n2", "n3", "n4", "loner" },
+               { "a", "a", "a", "a", "a" },
+               { "n1", "n2", "n3" },
+               { "n2", "n3", "n4" },
+               { "a" } };
+  my_sbm.initialize_blocks(2);
+
+  Node* loner             = my_sbm.get_node_by_id("loner");
+  const Node* loner_block = loner->parent();
+
+  for (const bool heat_bath : { false, true }) {
+    const auto sweep_res = my_sbm.mcmc_sweep(10, 0.5, false, false, 0, false, heat_bath);
+    REQUIRE(loner->parent() == loner_block);
+    for (const auto& moved : sweep_res.nodes_moved) REQUIRE(moved != "loner");
+  }
+}
@@ -0,0 +1,167 @@
+#include "build_testing_networks.h"
+#include "catch.hpp"
+
+// Block edge counts built by walking every data-level edge of every block
+inline bool block_edges_match_data(const SBM& my_sbm)
+{
+  for (int level = 1; level < my_sbm.n_levels(); level++) {
+    for (const auto& blocks_of_type : my_sbm.get_nodes_at_level(level)) {
+      for (const auto& block : blocks_of_type) {
+        Edge_Count_Map from_data;
+        block->for_all_neighbors([&](const Node* n, const int weight) { from_data[n->parent_at_level(level)] += weight; });
+
+        if (from_data != block->block_edges()) return false;
+      }
+    }
+  }
+  return true;
+}
+
+TEST_CASE("Block edge counts follow node moves and merges", "[Node]")
+{
+  auto my_sbm = simple_unipartite();
+  REQUIRE(block_edges_match_data(my_sbm));
+
+  // Block "a" holds n1 and n2 which share an edge
+  Node* a = my_sbm.get_node_by_id("n1")->parent();
+  Node* b = my_sbm.get_node_by_id("n3")->parent();
+  REQUIRE(a->block_edges().at(a) == 2);
+
+  my_sbm.get_node_by_id("n2")->set_parent(b);
+  REQUIRE(a->block_edges().count(a) == 0);
+  REQUIRE(block_edges_match_data(my_sbm));
+
+  // Add a level above and move things around in it
+  my_sbm.initialize_blocks(2);
+  REQUIRE(block_edges_match_data(my_sbm));
+
+  my_sbm.mcmc_sweep(5, 0.5, false, false, 0);
+  REQUIRE(block_edges_match_data(my_sbm));
+
+  my_sbm.mcmc_sweep(5, 0.5, false, false, 1);
+  REQUIRE(block_edges_match_data(my_sbm));
+
+  my_sbm.merge_blocks(my_sbm.get_nodes_of_type(0, 1).at(0).get(),
+                      my_sbm.get_nodes_of_type(0, 1).at(1).get());
+  REQUIRE(block_edges_match_data(my_sbm));
+}
+
+TEST_CASE("Moves proposed for blocks land at the level above", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(3, 8, 0.6, 0.05);
+
+  my_sbm.initialize_blocks(6);
+  my_sbm.initialize_blocks(3);
+
+  for (const auto& block : my_sbm.get_nodes_of_type(0, 1)) {
+    for (int i = 0; i < 10; i++) {
+      REQUIRE(my_sbm.propose_move(block.get(), 0.5)->level() == 2);
+    }
+  }
+}
+
+TEST_CASE("Move deltas for blocks account for their internal edges", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(3, 8, 0.6, 0.05);
+
+  my_sbm.initialize_blocks(6);
+  my_sbm.initialize_blocks(3);
+
+  const auto level_two_blocks = my_sbm.get_flat_level(2);
+
+  for (const auto& block : my_sbm.get_flat_level(1)) {
+    REQUIRE(block->self_edge_count() == block->block_edges().at(block));
+
+    for (Node* new_block : level_two_blocks) {
+      // Keep every block occupied so the number of blocks doesn't change
+      if (new_block == block->parent() || block->parent()->n_children() == 1) continue;
+
+      const int n_possible       = my_sbm.n_possible_neighbor_blocks(block);
+      const auto map_results     = get_move_results(block, new_block, n_possible, 0.1);
+      const auto dense_results   = Dense_Block_Counts(level_two_blocks).move_results(block, new_block, n_possible, 0.1);
+      const double pre_entropy   = my_sbm.entropy(1);
+
+      block->set_parent(new_block);
+
+      REQUIRE(my_sbm.entropy(1) - pre_entropy == Approx(map_results.entropy_delta));
+      REQUIRE(dense_results.entropy_delta == Approx(map_results.entropy_delta));
+      break;
+    }
+  }
+}
+
+TEST_CASE("Fitting a nested model", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(4, 10, 0.5, 0.03);
+
+  const auto results = my_sbm.fit_nested(2.0, // level ratio
+                                         5,   // checks per block
+                                         1,   // mcmc sweeps per merge step
+                                         3,   // nested sweeps
+                                         1.5, // sigma
+                                         0.1);
+
+  const int n_block_levels = my_sbm.n_levels() - 1;
+
+  REQUIRE(n_block_levels > 1);
+  REQUIRE(results.n_blocks.size() == n_block_levels);
+  REQUIRE(results.level_entropy.size() == n_block_levels);
+  REQUIRE(results.sweep_entropy_deltas.size() == 3);
+
+  // Every level should be smaller than the last, ending with a single block
+  for (int i = 1; i < n_block_levels; i++) {
+    REQUIRE(results.n_blocks[i] < results.n_blocks[i - 1]);
+  }
+  REQUIRE(results.n_blocks.back() == 1);
+
+  // Every node has a parent at every level
+  for (const auto& node : my_sbm.get_nodes_of_type(0, 0)) {
+    REQUIRE_NOTHROW(node->parent_at_level(n_block_levels));
+  }
+
+  REQUIRE(block_edges_match_data(my_sbm));
+}
+
+TEST_CASE("Variable block sweeps are not allowed inside a hierarchy", "[SBM]")
+{
+  auto my_sbm = simple_unipartite();
+  my_sbm.initialize_blocks(2);
+
+  REQUIRE_THROWS(my_sbm.mcmc_sweep(1, 0.1, true, false, 0));
+  REQUIRE_NOTHROW(my_sbm.mcmc_sweep(1, 0.1, true, false, 1));
+}
+
+TEST_CASE("Ancestor tables match parent chains through sweeps and merges", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(3, 8, 0.6, 0.05);
+
+  my_sbm.initialize_blocks(6);
+  my_sbm.initialize_blocks(3);
+
+  auto tables_match_chains = [&]() {
+    for (const auto& node : my_sbm.get_nodes_of_type(0, 0)) {
+      const Node* chain = node.get();
+      for (int level = 1; level < my_sbm.n_levels(); level++) {
+        chain = chain->parent();
+        if (node->parent_at_level(level) != chain) return false;
+      }
+    }
+    return true;
+  };
+
+  REQUIRE(tables_match_chains());
+
+  my_sbm.mcmc_sweep(3, 0.5, false, false, 0);
+  my_sbm.mcmc_sweep(3, 0.5, false, false, 1);
+  REQUIRE(tables_match_chains());
+
+  my_sbm.merge_blocks(my_sbm.get_nodes_of_type(0, 1).at(0).get(),
+                      my_sbm.get_nodes_of_type(0, 1).at(1).get());
+  REQUIRE(tables_match_chains());
+
+  // Dropping the top level leaves no dangling ancestors behind
+  my_sbm.remove_block_levels_above(1);
+  for (const auto& node : my_sbm.get_nodes_of_type(0, 0)) {
+    REQUIRE(node->ancestors().size() == 1);
+  }
+}
@@ -3,16 +3,16 @@
 
 TEST_CASE("Basic Initialization", "[Node]")
 {
-  Node_UPtr n1 = Node_UPtr(new Node { "n1", 0, 0, 2 });
-  Node_UPtr n2 = Node_UPtr(new Node { "n2", 0, 0, 2 });
-  Node_UPtr n3 = Node_UPtr(new Node { "n3", 0, 0, 2 });
-  Node_UPtr m1 = Node_UPtr(new Node { "m1", 0, 1, 2 });
-  Node_UPtr m2 = Node_UPtr(new Node { "m2", 0, 1, 2 });
-  Node_UPtr m3 = Node_UPtr(new Node { "m3", 0, 1, 2 });
-  Node_UPtr c1 = Node_UPtr(new Node { "c1", 1, 1, 2 });
-  Node_UPtr c2 = Node_UPtr(new Node { "c2", 1, 1, 2 });
-  Node_UPtr d1 = Node_UPtr(new Node { "d1", 1, 1, 2 });
-  Node_UPtr d2 = Node_UPtr(new Node { "d2", 1, 1, 2 });
+  Node_UPtr n1 = Node_UPtr(new Node { "n1", 0, 0 });
+  Node_UPtr n2 = Node_UPtr(new Node { "n2", 0, 0 });
+  Node_UPtr n3 = Node_UPtr(new Node { "n3", 0, 0 });
+  Node_UPtr m1 = Node_UPtr(new Node { "m1", 0, 1 });
+  Node_UPtr m2 = Node_UPtr(new Node { "m2", 0, 1 });
+  Node_UPtr m3 = Node_UPtr(new Node { "m3", 0, 1 });
+  Node_UPtr c1 = Node_UPtr(new Node { "c1", 1, 1 });
+  Node_UPtr c2 = Node_UPtr(new Node { "c2", 1, 1 });
+  Node_UPtr d1 = Node_UPtr(new Node { "d1", 1, 1 });
+  Node_UPtr d2 = Node_UPtr(new Node { "d2", 1, 1 });
 
   n1->set_parent(c1.get());
   n2->set_parent(c1.get());
@@ -74,22 +74,22 @@ TEST_CASE("Child addition and deletion", "[Node]")
 TEST_CASE("Gathering edge counts to a level", "[Node]")
 {
   // Node level
-  Node_UPtr a1 = Node_UPtr(new Node { "a1", 0, 0, 2 });
-  Node_UPtr a2 = Node_UPtr(new Node { "a2", 0, 0, 2 });
-  Node_UPtr a3 = Node_UPtr(new Node { "a3", 0, 0, 2 });
-  Node_UPtr b1 = Node_UPtr(new Node { "b1", 0, 1, 2 });
-  Node_UPtr b2 = Node_UPtr(new Node { "b2", 0, 1, 2 });
-  Node_UPtr b3 = Node_UPtr(new Node { "b3", 0, 1, 2 });
+  Node_UPtr a1 = Node_UPtr(new Node { "a1", 0, 0 });
+  Node_UPtr a2 = Node_UPtr(new Node { "a2", 0, 0 });
+  Node_UPtr a3 = Node_UPtr(new Node { "a3", 0, 0 });
+  Node_UPtr b1 = Node_UPtr(new Node { "b1", 0, 1 });
+  Node_UPtr b2 = Node_UPtr(new Node { "b2", 0, 1 });
+  Node_UPtr b3 = Node_UPtr(new Node { "b3", 0, 1 });
 
   // First level / blocks
-  Node_UPtr a11 = Node_UPtr(new Node { "a11", 1, 0, 2 });
-  Node_UPtr a12 = Node_UPtr(new Node { "a12", 1, 0, 2 });
-  Node_UPtr b11 = Node_UPtr(new Node { "b11", 1, 1, 2 });
-  Node_UPtr b12 = Node_UPtr(new Node { "b12", 1, 1, 2 });
+  Node_UPtr a11 = Node_UPtr(new Node { "a11", 1, 0 });
+  Node_UPtr a12 = Node_UPtr(new Node { "a12", 1, 0 });
+  Node_UPtr b11 = Node_UPtr(new Node { "b11", 1, 1 });
+  Node_UPtr b12 = Node_UPtr(new Node { "b12", 1, 1 });
 
   // Second level / super blocks
-  Node_UPtr a21 = Node_UPtr(new Node { "a21", 2, 0, 2 });
-  Node_UPtr b21 = Node_UPtr(new Node { "b21", 2, 1, 2 });
+  Node_UPtr a21 = Node_UPtr(new Node { "a21", 2, 0 });
+  Node_UPtr b21 = Node_UPtr(new Node { "b21", 2, 1 });
 
   connect_nodes(a1.get(), b1.get());
   connect_nodes(a1.get(), b2.get());
@@ -198,12 +198,12 @@ TEST_CASE("Edge count gathering (unipartite)", "[Node]")
 
 TEST_CASE("Edge count gathering after moving (unipartite)", "[Node]")
 {
-  Node_UPtr n1 = Node_UPtr(new Node { "n1", 0, 0, 1 });
-  Node_UPtr n2 = Node_UPtr(new Node { "n2", 0, 0, 1 });
-  Node_UPtr n3 = Node_UPtr(new Node { "n3", 0, 0, 1 });
-  Node_UPtr n4 = Node_UPtr(new Node { "n4", 0, 0, 1 });
-  Node_UPtr n5 = Node_UPtr(new Node { "n5", 0, 0, 1 });
-  Node_UPtr n6 = Node_UPtr(new Node { "n6", 0, 0, 1 });
+  Node_UPtr n1 = Node_UPtr(new Node { "n1", 0, 0 });
+  Node_UPtr n2 = Node_UPtr(new Node { "n2", 0, 0 });
+  Node_UPtr n3 = Node_UPtr(new Node { "n3", 0, 0 });
+  Node_UPtr n4 = Node_UPtr(new Node { "n4", 0, 0 });
+  Node_UPtr n5 = Node_UPtr(new Node { "n5", 0, 0 });
+  Node_UPtr n6 = Node_UPtr(new Node { "n6", 0, 0 });
 
   // Add edges
   connect_nodes(n1.get(), n2.get());
@@ -253,22 +253,22 @@ TEST_CASE("Edge count gathering after moving (unipartite)", "[Node]")
 TEST_CASE("Tracking node degrees", "[Node]")
 {
   // Node level
-  Node_UPtr a1 = Node_UPtr(new Node { "a1", 0, 0, 2 });
-  Node_UPtr a2 = Node_UPtr(new Node { "a2", 0, 0, 2 });
-  Node_UPtr a3 = Node_UPtr(new Node { "a3", 0, 0, 2 });
-  Node_UPtr b1 = Node_UPtr(new Node { "b1", 0, 1, 2 });
-  Node_UPtr b2 = Node_UPtr(new Node { "b2", 0, 1, 2 });
-  Node_UPtr b3 = Node_UPtr(new Node { "b3", 0, 1, 2 });
+  Node_UPtr a1 = Node_UPtr(new Node { "a1", 0, 0 });
+  Node_UPtr a2 = Node_UPtr(new Node { "a2", 0, 0 });
+  Node_UPtr a3 = Node_UPtr(new Node { "a3", 0, 0 });
+  Node_UPtr b1 = Node_UPtr(new Node { "b1", 0, 1 });
+  Node_UPtr b2 = Node_UPtr(new Node { "b2", 0, 1 });
+  Node_UPtr b3 = Node_UPtr(new Node { "b3", 0, 1 });
 
   // First level / blocks
-  Node_UPtr a11 = Node_UPtr(new Node { "a11", 1, 0, 2 });
-  Node_UPtr a12 = Node_UPtr(new Node { "a12", 1, 0, 2 });
-  Node_UPtr b11 = Node_UPtr(new Node { "b11", 1, 1, 2 });
-  Node_UPtr b12 = Node_UPtr(new Node { "b12", 1, 1, 2 });
+  Node_UPtr a11 = Node_UPtr(new Node { "a11", 1, 0 });
+  Node_UPtr a12 = Node_UPtr(new Node { "a12", 1, 0 });
+  Node_UPtr b11 = Node_UPtr(new Node { "b11", 1, 1 });
+  Node_UPtr b12 = Node_UPtr(new Node { "b12", 1, 1 });
 
   // Second level / super blocks
-  Node_UPtr a21 = Node_UPtr(new Node { "a21", 2, 0, 2 });
-  Node_UPtr b21 = Node_UPtr(new Node { "b21", 2, 1, 2 });
+  Node_UPtr a21 = Node_UPtr(new Node { "a21", 2, 0 });
+  Node_UPtr b21 = Node_UPtr(new Node { "b21", 2, 1 });
 
   connect_nodes(a1.get(), b1.get());
   connect_nodes(a1.get(), b2.get());
@@ -326,3 +326,72 @@ TEST_CASE("Tracking node degrees", "[Node]")
   REQUIRE(a21->degree() == 6);
   REQUIRE(b21->degree() == 6);
 }
+
+TEST_CASE("Ancestor table follows parent changes", "[Node]")
+{
+  // Two data nodes, two blocks, and two metablocks. Declared bottom up so
+  // parents are destroyed before their children
+  Node_UPtr n1    = Node_UPtr(new Node { "n1", 0, 0 });
+  Node_UPtr n2    = Node_UPtr(new Node { "n2", 0, 0 });
+  Node_UPtr b1    = Node_UPtr(new Node { "b1", 1, 0 });
+  Node_UPtr b2    = Node_UPtr(new Node { "b2", 1, 0 });
+  Node_UPtr top_1 = Node_UPtr(new Node { "top_1", 2, 0 });
+  Node_UPtr top_2 = Node_UPtr(new Node { "top_2", 2, 0 });
+
+  n1->set_parent(b1.get());
+  n2->set_parent(b2.get());
+
+  // No metablocks yet
+  REQUIRE(n1->ancestors().size() == 1);
+  REQUIRE(n1->ancestor_at_level(2) == nullptr);
+  REQUIRE_THROWS(n1->parent_at_level(2));
+
+  // Giving a block a parent reaches down to its children
+  b1->set_parent(top_1.get());
+  b2->set_parent(top_1.get());
+  REQUIRE(n1->parent_at_level(2) == top_1.get());
+  REQUIRE(n2->parent_at_level(2) == top_1.get());
+
+  // Moving a block updates its children's view of levels above it
+  b2->set_parent(top_2.get());
+  REQUIRE(n2->parent_at_level(1) == b2.get());
+  REQUIRE(n2->parent_at_level(2) == top_2.get());
+  REQUIRE(n1->parent_at_level(2) == top_1.get());
+
+  // Moving a data node picks up its new block's ancestors
+  n1->set_parent(b2.get());
+  REQUIRE(n1->parent_at_level(2) == top_2.get());
+
+  // Losing a parent clears ancestors for whole subtree
+  b2->remove_parent();
+  REQUIRE(n1->ancestors().size() == 1);
+  REQUIRE(n2->ancestor_at_level(2) == nullptr);
+}
+
+TEST_CASE("Repeated edges to a hub merge past the indexed list size", "[Node]")
+{
+  const int n_spokes = 3 * NEIGHBOR_INDEX_THRESHOLD;
+  Node_UPtr hub      = Node_UPtr(new Node { "hub", 0, 0 });
+  std::vector<Node_UPtr> spokes;
+  for (int i = 0; i < n_spokes; i++) {
+    spokes.push_back(Node_UPtr(new Node { "s" + std::to_string(i), 0, 0 }));
+  }
+
+  // Second pass finds every spoke through the index
+  for (int pass = 0; pass < 2; pass++) {
+    for (const auto& spoke : spokes) connect_nodes(hub.get(), spoke.get());
+  }
+  connect_nodes(hub.get(), hub.get());
+  connect_nodes(hub.get(), hub.get());
+
+  REQUIRE(hub->neighbors().size() == n_spokes + 1);
+  REQUIRE(hub->degree() == 2 * n_spokes + 4);
+  REQUIRE(hub->self_edge_count() == 4);
+  for (const auto& neighbor : hub->neighbors()) {
+    REQUIRE(neighbor.weight == (neighbor.node == hub.get() ? 4 : 2));
+  }
+  for (const auto& spoke : spokes) {
+    REQUIRE(spoke->neighbors().size() == 1);
+    REQUIRE(spoke->degree() == 2);
+  }
+}
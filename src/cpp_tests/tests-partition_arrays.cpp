@@ -0,0 +1,139 @@
+#include "../partition_arrays.h"
+#include "build_testing_networks.h"
+#include "catch.hpp"
+
+// Arrays hold the same partition as the nodes they were built from
+void check_arrays_match(const Partition_Arrays& partition, const Node_Vec& nodes, const Node_Vec& blocks)
+{
+  REQUIRE(partition.n_nodes() == nodes.size());
+  REQUIRE(partition.n_blocks() == blocks.size());
+
+  for (int i = 0; i < nodes.size(); i++) {
+    REQUIRE(partition.node(i) == nodes[i]);
+    REQUIRE(partition.index(nodes[i]) == i);
+    REQUIRE(partition.block(partition.block_of[i]) == nodes[i]->parent());
+    REQUIRE(partition.degree[i] == nodes[i]->degree());
+    REQUIRE(partition.type[i] == nodes[i]->type());
+    REQUIRE(partition.self_edges[i] == nodes[i]->self_edge_count());
+
+    int edge_total = 0;
+    for (int e = partition.edge_start[i]; e < partition.edge_start[i + 1]; e++) edge_total += partition.edge_weight[e];
+    REQUIRE(edge_total == nodes[i]->degree());
+  }
+
+  for (int b = 0; b < blocks.size(); b++) {
+    REQUIRE(partition.block_degree[b] == blocks[b]->degree());
+    REQUIRE(partition.block_size[b] == blocks[b]->n_children());
+    REQUIRE(partition.block_type[b] == blocks[b]->type());
+  }
+}
+
+TEST_CASE("Partition arrays mirror the nodes of a level", "[Partition]")
+{
+  // Bipartite with two node types
+  auto bipartite = simple_bipartite();
+  check_arrays_match(Partition_Arrays(bipartite.get_flat_level(0), bipartite.get_flat_level(1), 2),
+                     bipartite.get_flat_level(0),
+                     bipartite.get_flat_level(1));
+
+  // Self edges and a level of blocks swept against a level above
+  auto my_sbm = planted_unipartite(3, 10, 0.5, 0.1);
+  my_sbm.add_edge("n0", "n0");
+  my_sbm.initialize_blocks(6);
+  my_sbm.initialize_blocks(2);
+
+  for (const int level : { 0, 1 }) {
+    const auto nodes  = my_sbm.get_flat_level(level);
+    const auto blocks = my_sbm.get_flat_level(level + 1);
+    check_arrays_match(Partition_Arrays(nodes, blocks, 1), nodes, blocks);
+  }
+}
+
+TEST_CASE("Moves scored from partition arrays match node based results", "[Partition]")
+{
+  auto my_sbm = planted_unipartite(4, 15, 0.5, 0.05);
+  my_sbm.add_edge("n3", "n3");
+  my_sbm.initialize_blocks(10);
+
+  const auto nodes  = my_sbm.get_flat_level(0);
+  const auto blocks = my_sbm.get_flat_level(1);
+
+  Partition_Arrays partition(nodes, blocks, 1);
+  Dense_Block_Counts dense_counts(partition.blocks());
+
+  Sampler sampler(312);
+  for (int step = 0; step < 200; step++) {
+    const int i = sampler.get_rand_int(nodes.size() - 1);
+    const int s = sampler.get_rand_int(blocks.size() - 1);
+    if (partition.block_of[i] == s) continue;
+
+    Node* node           = nodes[i];
+    const int n_possible = my_sbm.n_possible_neighbor_blocks(node);
+    const auto map_res   = get_move_results(node, blocks[s], n_possible, 0.1);
+    const auto array_res = dense_counts.move_results(partition, i, s, n_possible, 0.1);
+
+    REQUIRE(array_res.entropy_delta == Approx(map_res.entropy_delta));
+    REQUIRE(array_res.prob_ratio == Approx(map_res.prob_ratio));
+
+    // Keep every other move, through the arrays and the nodes both
+    if (step % 2 == 0 && partition.block_size[partition.block_of[i]] > 1) {
+      dense_counts.commit_move(partition, i, s);
+      partition.move(i, s);
+      node->set_parent(blocks[s]);
+    }
+  }
+
+  check_arrays_match(partition, nodes, blocks);
+
+  const Dense_Block_Counts fresh_counts(blocks);
+  for (const auto& block_a : blocks) {
+    for (const auto& block_b : blocks) {
+      REQUIRE(dense_counts.edges_between(block_a, block_b) == fresh_counts.edges_between(block_a, block_b));
+    }
+  }
+}
+
+// Degree, size, and edge counts to other blocks of every block at level, by id
+std::map<string, std::map<string, int>> block_contents(const SBM& my_sbm, const int level)
+{
+  std::map<string, std::map<string, int>> structure;
+  for (const Node* block : my_sbm.get_flat_level(level)) {
+    auto& counts       = structure[block->id()];
+    counts["degree"]   = block->degree();
+    counts["children"] = block->n_children();
+    for (const auto& block_count : block->block_edges()) counts[block_count.first->id()] = block_count.second;
+  }
+  return structure;
+}
+
+TEST_CASE("Fixed block sweeps keep nodes and their blocks in step", "[Partition]")
+{
+  // Blocks on top get written back whole, with a level above them every
+  // node is moved on its own
+  for (const int n_levels : { 1, 2 }) {
+    for (const bool heat_bath : { false, true }) {
+      auto my_sbm = planted_unipartite(4, 15, 0.5, 0.05);
+      my_sbm.add_edge("n0", "n0");
+      my_sbm.initialize_blocks(5);
+      if (n_levels == 2) my_sbm.initialize_blocks(2);
+      my_sbm.mcmc_sweep(5, 0.1, false, false, 0, false, heat_bath);
+
+      // Same blocks given to a fresh copy of the network
+      const State_Dump state = my_sbm.state();
+      auto rebuilt           = planted_unipartite(4, 15, 0.5, 0.05);
+      rebuilt.add_edge("n0", "n0");
+      rebuilt.update_state(state.ids, state.types, state.parents, state.levels);
+
+      REQUIRE(my_sbm.entropy(0) == Approx(rebuilt.entropy(0)));
+      for (int level = 1; level <= n_levels; level++) {
+        REQUIRE(block_contents(my_sbm, level) == block_contents(rebuilt, level));
+      }
+      // Nodes and blocks agree on who's in which block
+      for (Node* node : my_sbm.get_flat_level(0)) {
+        REQUIRE(node->parent()->has_child(node));
+        REQUIRE(node->ancestors().size() == n_levels);
+        REQUIRE(node->ancestors()[0] == node->parent());
+      }
+    }
+  }
+}
@@ -0,0 +1,76 @@
+#include "build_testing_networks.h"
+#include "catch.hpp"
+
+TEST_CASE("Cloning a network keeps data and block structure", "[SBM]")
+{
+  auto my_sbm = simple_bipartite();
+
+  auto copy = my_sbm.clone(312);
+
+  REQUIRE(copy->n_nodes_at_level(0) == my_sbm.n_nodes_at_level(0));
+  REQUIRE(copy->n_nodes_at_level(1) == my_sbm.n_nodes_at_level(1));
+  REQUIRE(copy->n_edges() == my_sbm.n_edges());
+  REQUIRE(copy->entropy(0) == Approx(my_sbm.entropy(0)));
+
+  // Same blocks should hold same nodes
+  REQUIRE(copy->get_node_by_id("a2")->parent()->id() == my_sbm.get_node_by_id("a2")->parent()->id());
+  REQUIRE(copy->get_node_by_id("b4")->parent()->id() == my_sbm.get_node_by_id("b4")->parent()->id());
+
+  // Moving the copy's nodes shouldn't touch the original
+  copy->mcmc_sweep(5, 0.5, false, false);
+  REQUIRE(my_sbm.get_node_by_id("a3")->parent() == my_sbm.get_node_by_id("a2")->parent());
+}
+
+TEST_CASE("Tempered sweeps accept more moves when hot", "[SBM]")
+{
+  const int n_sweeps = 30;
+
+  auto cold_sbm = simple_unipartite();
+  auto hot_sbm  = simple_unipartite();
+
+  const auto cold_res = cold_sbm.mcmc_sweep_at_temp(n_sweeps, 0.1, false, false, 0, false, 1.0);
+  const auto hot_res  = hot_sbm.mcmc_sweep_at_temp(n_sweeps, 0.1, false, false, 0, false, 0.05);
+
+  REQUIRE(cold_res.nodes_moved.size() < hot_res.nodes_moved.size());
+}
+
+TEST_CASE("Replica exchange - Simple Unipartite", "[SBM]")
+{
+  auto my_sbm = simple_unipartite();
+
+  const int n_rounds            = 15;
+  const InOut_Double_Vec betas  = { 1.0, 0.7, 0.4, 0.1 };
+  const int n_blocks_at_start   = my_sbm.n_nodes_at_level(1);
+  const Tempering_Results res   = my_sbm.replica_exchange(betas,
+                                                        n_rounds,
+                                                        2,     // sweeps per round
+                                                        0.1,   // eps
+                                                        false, // variable num blocks
+                                                        0,     // level
+                                                        true); // record states
+
+  REQUIRE(res.cold_entropy.size() == n_rounds);
+  REQUIRE(res.cold_states.size() == n_rounds);
+  REQUIRE(res.n_swaps_proposed.size() == betas.size() - 1);
+
+  int total_proposed = 0;
+  for (int i = 0; i < res.n_swaps_proposed.size(); i++) {
+    REQUIRE(res.n_swaps_accepted[i] <= res.n_swaps_proposed[i]);
+    total_proposed += res.n_swaps_proposed[i];
+  }
+  REQUIRE(total_proposed > 0);
+
+  // The running entropy kept for cold chain should match its actual entropy
+  // and the network should now be in that state
+  REQUIRE(my_sbm.entropy(0) == Approx(res.cold_entropy.back()));
+  REQUIRE(my_sbm.n_nodes_at_level(1) == n_blocks_at_start);
+  REQUIRE(my_sbm.n_nodes_at_level(0) == 6);
+}
+
+TEST_CASE("Replica exchange needs a cold chain", "[SBM]")
+{
+  auto my_sbm = simple_bipartite();
+
+  REQUIRE_THROWS(my_sbm.replica_exchange({ 0.5, 0.2 }, 2, 1, 0.1));
+  REQUIRE_THROWS(my_sbm.replica_exchange({ 1.0 }, 2, 1, 0.1));
+}
@@ -220,3 +220,60 @@ TEST_CASE("Node vector shuffling respects seeds", "[Sampler]")
     REQUIRE(n_shouldnt_match < n_nodes);
   }
 }
+
+TEST_CASE("Chunk shuffling only mixes within runs", "[Sampler]")
+{
+  Sampler sampler(42);
+  const int chunk_size = 8;
+
+  // Doesn't divide evenly so the last run is short
+  std::vector<int> ordered(50);
+  std::iota(ordered.begin(), ordered.end(), 0);
+
+  std::vector<int> shuffled;
+  bool changed_order = false;
+  for (int rep = 0; rep < 20; rep++) {
+    sampler.chunk_shuffle(ordered, shuffled, chunk_size);
+    changed_order = changed_order || shuffled != ordered;
+
+    // Still every element once
+    std::vector<int> sorted = shuffled;
+    std::sort(sorted.begin(), sorted.end());
+    REQUIRE(sorted == ordered);
+
+    // Elements of a run stay next to each other
+    for (int i = 0; i < shuffled.size();) {
+      const int chunk    = shuffled[i] / chunk_size;
+      const int run_size = std::min(chunk_size, int(ordered.size()) - chunk * chunk_size);
+      for (int j = i; j < i + run_size; j++) REQUIRE(shuffled[j] / chunk_size == chunk);
+      i += run_size;
+    }
+  }
+  REQUIRE(changed_order);
+}
+
+TEST_CASE("Batched uniform draws", "[Sampler]")
+{
+  Sampler sampler_1(42);
+  Sampler sampler_2(42);
+
+  std::vector<double> draws_1, draws_2;
+  sampler_1.fill_unif(draws_1, 10000);
+  sampler_2.fill_unif(draws_2, 10000);
+
+  // Same seed, same batch
+  REQUIRE(draws_1.size() == 10000);
+  REQUIRE(draws_1 == draws_2);
+
+  // Open unit interval and centered on a half
+  REQUIRE(*std::min_element(draws_1.begin(), draws_1.end()) > 0.0);
+  REQUIRE(*std::max_element(draws_1.begin(), draws_1.end()) < 1.0);
+  REQUIRE(std::accumulate(draws_1.begin(), draws_1.end(), 0.0) / draws_1.size() == Approx(0.5).epsilon(0.02));
+
+  // Integers cover the whole range evenly and never step past it
+  std::vector<int> counts(5, 0);
+  for (const double draw : draws_1) counts[Sampler::unif_to_int(draw, 4)]++;
+  for (const int count : counts) REQUIRE(count == Approx(2000).epsilon(0.1));
+  REQUIRE(Sampler::unif_to_int(0.9999999999, 4) == 4);
+  REQUIRE(Sampler::unif_to_int(0.0, 4) == 0);
+}
@@ -1,4 +1,5 @@
 #include "../SBM.h"
+#include "build_testing_networks.h"
 #include "catch.hpp"
 #include <set>
 
@@ -345,6 +346,51 @@ TEST_CASE("State dumping and restoring", "[Network")
           == my_net2.get_node_by_id("a2")->parent());
 }
 
+TEST_CASE("Compact state dumping and restoring", "[Network]")
+{
+  auto my_net = simple_bipartite();
+
+  // Add a metablock level so multiple levels get exported
+  my_net.initialize_blocks(2);
+
+  const Compact_State state1 = my_net.compact_state();
+
+  // One vector per block level indexed by data node insertion order
+  REQUIRE(state1.size() == 2);
+  REQUIRE(state1[0].size() == my_net.n_nodes_at_level(0));
+  REQUIRE(state1[1].size() == my_net.n_nodes_at_level(1));
+  REQUIRE(my_net.data_node_ids()[0] == "a1");
+
+  // First node always sees first parent index
+  REQUIRE(state1[0][0] == 0);
+  REQUIRE(state1[1][0] == 0);
+
+  // Relabeling blocks doesn't change the compact state
+  my_net.update_state(state1);
+  REQUIRE(my_net.compact_state() == state1);
+  REQUIRE(my_net.n_nodes_at_level(1) == 6);
+  REQUIRE(my_net.n_nodes_at_level(2) == 4);
+
+  // Move a node and restore
+  Node* a1 = my_net.get_node_by_id("a1");
+  my_net.swap_blocks(a1, my_net.get_node_by_id("a3")->parent(), true);
+  REQUIRE(my_net.compact_state() != state1);
+
+  my_net.update_state(state1);
+  REQUIRE(my_net.compact_state() == state1);
+  REQUIRE(a1->parent() != my_net.get_node_by_id("a3")->parent());
+
+  // Blocks can't mix node types
+  Compact_State mixed_state = state1;
+  mixed_state[0][1] = mixed_state[0][my_net.n_nodes_at_level(0) - 1];
+  REQUIRE_THROWS(my_net.update_state(mixed_state));
+
+  // Size must match the data
+  Compact_State short_state = state1;
+  short_state[0].pop_back();
+  REQUIRE_THROWS(my_net.update_state(short_state));
+}
+
 TEST_CASE("State dumping and restoring: w/ metablocks", "[Network")
 {
   SBM my_net({ "a", "b" }, 42);
@@ -498,6 +544,186 @@ TEST_CASE("Building with vectors -- Restricted tripartite", "[Network]")
                     type_from, type_to });
 }
 
+TEST_CASE("Possible neighbor block counts follow block changes", "[Network]")
+{
+  // a-b and b-c connections, a and c never meet
+  const std::vector<string> nodes_id { "a1", "a2", "a3", "b1", "b2", "b3", "c1", "c2", "c3" };
+  const std::vector<string> nodes_type { "a", "a", "a", "b", "b", "b", "c", "c", "c" };
+  const std::vector<string> types_name { "a", "b", "c" };
+  const std::vector<string> edges_from { "a1", "a2", "a3", "b1", "b2", "b3" };
+  const std::vector<string> edges_to { "b1", "b2", "b3", "c1", "c2", "c3" };
+
+  SBM my_net { nodes_id, nodes_type, edges_from, edges_to, types_name };
+
+  // Count by walking the blocks of every type a node shares edges with
+  const auto brute_force = [&](Node* node) {
+    const int level = node->level() + 1;
+    if (node->type() == 1) return my_net.n_nodes_of_type("a", level) + my_net.n_nodes_of_type("c", level);
+    return my_net.n_nodes_of_type("b", level);
+  };
+
+  const auto check_all = [&]() {
+    for (Node* node : my_net.get_flat_level(0)) {
+      REQUIRE(my_net.n_possible_neighbor_blocks(node) == brute_force(node));
+    }
+  };
+
+  my_net.initialize_blocks(-1);
+  check_all();
+
+  // Merging removes a block, adding brings one back from the pool
+  Node* a1 = my_net.get_node_by_id("a1");
+  Node* a2 = my_net.get_node_by_id("a2");
+  my_net.merge_blocks(a1->parent(), a2->parent());
+  check_all();
+  REQUIRE(my_net.n_possible_neighbor_blocks(my_net.get_node_by_id("b1")) == 5);
+
+  my_net.swap_blocks(a1, my_net.add_block_node(0));
+  check_all();
+
+  my_net.remove_empty_blocks(1);
+  check_all();
+
+  // Starting over rebuilds the counts for the new levels
+  my_net.reset_blocks();
+  my_net.initialize_blocks(2);
+  check_all();
+  REQUIRE(my_net.n_possible_neighbor_blocks(a1) == 2);
+
+  // Copies keep their own counts
+  const auto copy = my_net.clone(42);
+  REQUIRE(copy->n_possible_neighbor_blocks(copy->get_node_by_id("b2")) == 4);
+}
+
+TEST_CASE("Block ids stay unique after resetting a collapsed model", "[Network]")
+{
+  // Chain of 30 nodes
+  std::vector<string> ids, types, edges_from, edges_to;
+  for (int i = 0; i < 30; i++) {
+    ids.push_back("n" + std::to_string(i));
+    types.push_back("node");
+    if (i > 0) {
+      edges_from.push_back(ids[i - 1]);
+      edges_to.push_back(ids[i]);
+    }
+  }
+  SBM my_net { ids, types, edges_from, edges_to, { "node" } };
+
+  const auto require_unique_ids = [&]() {
+    std::set<string> block_ids;
+    for (Node* block : my_net.get_flat_level(1)) block_ids.insert(block->id());
+    REQUIRE(block_ids.size() == my_net.get_flat_level(1).size());
+  };
+
+  // Collapsing deletes blocks into the pool
+  my_net.initialize_blocks(10);
+  my_net.collapse_blocks(0, 1, 2, 0, 2, 0.1, false, true);
+  require_unique_ids();
+
+  // Starting over must not hand the pooled blocks back alongside new ones
+  my_net.reset_blocks();
+  my_net.initialize_blocks(-1);
+  REQUIRE(my_net.get_flat_level(1).size() == 30);
+  require_unique_ids();
+}
+
+TEST_CASE("Type layouts pick the right proposal code", "[Network]")
+{
+  auto unipartite = simple_unipartite();
+  auto bipartite  = simple_bipartite();
+  REQUIRE(unipartite.type_layout() == single_neighbor_type);
+  REQUIRE(bipartite.type_layout() == single_neighbor_type);
+
+  // b connects to both a and c
+  SBM tripartite { { "a1", "b1", "c1" }, { "a", "b", "c" }, { "a1", "b1" }, { "b1", "c1" }, { "a", "b", "c" } };
+  REQUIRE(tripartite.type_layout() == mixed_neighbor_types);
+
+  // Single neighbor type proposals count a neighbor block's whole degree as
+  // edges back to the node's type, which needs every block edge to lead there
+  for (const auto& block : bipartite.get_flat_level(1)) {
+    int n_edges_to_other = 0;
+    for (const auto& block_count : block->block_edges()) {
+      if (block_count.first->type() != block->type()) n_edges_to_other += block_count.second;
+    }
+    REQUIRE(n_edges_to_other == block->degree());
+  }
+
+  // Both versions only ever propose blocks of the node's own type
+  for (int i = 0; i < 100; i++) {
+    for (const auto& node : bipartite.get_flat_level(0)) {
+      const Node* single_block = bipartite.propose_move<single_neighbor_type>(node, 1, 0.1);
+      const Node* mixed_block  = bipartite.propose_move<mixed_neighbor_types>(node, 1, 0.1);
+      REQUIRE(single_block->type() == node->type());
+      REQUIRE(mixed_block->type() == node->type());
+    }
+  }
+}
+
+TEST_CASE("Reordering nodes keeps the network the same", "[Network]")
+{
+  // Path a - b - c - ... added in scrambled order
+  std::vector<string> ids;
+  for (int i = 0; i < 20; i++) ids.push_back("n" + as_str(i));
+  std::vector<string> scrambled = ids;
+  std::shuffle(scrambled.begin(), scrambled.end(), std::mt19937(42));
+
+  SBM my_sbm;
+  for (const auto& id : scrambled) my_sbm.add_node(id, "node");
+  for (int i = 0; i + 1 < ids.size(); i++) my_sbm.add_edge(ids[i], ids[i + 1]);
+  my_sbm.add_edge("n4", "n4", 2);
+
+  // Widest gap between the two ends of an edge in storage order
+  const auto bandwidth = [&]() {
+    std::map<const Node*, int> position;
+    const auto& stored = my_sbm.get_nodes_of_type(0);
+    for (int i = 0; i < stored.size(); i++) position[stored[i].get()] = i;
+
+    int widest = 0;
+    for (const auto& node : stored) {
+      for (const auto& neighbor : node->neighbors()) {
+        widest = std::max(widest, std::abs(position[node.get()] - position[neighbor.node]));
+      }
+    }
+    return widest;
+  };
+
+  const auto edges_of = [&](const string& id) {
+    std::map<string, int> edges;
+    for (const auto& neighbor : my_sbm.get_node_by_id(id)->neighbors()) edges[neighbor.node->id()] = neighbor.weight;
+    return edges;
+  };
+
+  std::map<string, std::map<string, int>> original_edges;
+  for (const auto& id : ids) original_edges[id] = edges_of(id);
+  const auto original_ids = my_sbm.data_node_ids();
+  REQUIRE(bandwidth() > 1);
+
+  my_sbm.reorder_nodes("rcm", 4);
+  REQUIRE(bandwidth() == 1);
+  REQUIRE(my_sbm.n_edges() == 21);
+  REQUIRE(my_sbm.data_node_ids() == original_ids);
+  REQUIRE(my_sbm.get_node_by_id("n4")->self_edge_count() == 4);
+  for (const auto& id : ids) REQUIRE(edges_of(id) == original_edges[id]);
+
+  // Busiest node first
+  my_sbm.reorder_nodes("degree", 4);
+  REQUIRE(my_sbm.get_nodes_of_type(0)[0]->id() == "n4");
+  for (const auto& id : ids) REQUIRE(edges_of(id) == original_edges[id]);
+
+  REQUIRE_THROWS(my_sbm.reorder_nodes("alphabetical", 4));
+
+  // Sweeps over the reordered nodes still keep track of entropy
+  my_sbm.initialize_blocks(3);
+  REQUIRE_THROWS(my_sbm.reorder_nodes("rcm", 4));
+  const double pre_entropy = my_sbm.entropy(0);
+  const auto sweep_res     = my_sbm.mcmc_sweep(5, 0.1, false, false, 0);
+  REQUIRE(my_sbm.entropy(0) - pre_entropy == Approx(sweep_res.entropy_delta).margin(1e-6));
+
+  // Copies are laid out the same way
+  const auto copy = my_sbm.clone(42);
+  REQUIRE(copy->get_nodes_of_type(0)[0]->id() == "n4");
+}
+
 TEST_CASE("Counting edges", "[Network]")
 {
   SBM my_net { { "a", "b" }, 42 };
@@ -664,3 +890,72 @@ TEST_CASE("Counting edges", "[Network]")
   REQUIRE(a22_edges_new[b21] == 2);
   REQUIRE(a22_edges_new[b22] == 2);
 }
+
+TEST_CASE("Weighted edges match repeated edges", "[Network]")
+{
+  const std::vector<string> ids { "n1", "n2", "n3", "n4", "n5", "n6" };
+  const InOut_String_Vec edges_a { "n1", "n1", "n2", "n3", "n4", "n5", "n6", "n2" };
+  const InOut_String_Vec edges_b { "n2", "n3", "n3", "n4", "n5", "n6", "n4", "n2" };
+  const InOut_Int_Vec weights { 3, 1, 5, 2, 4, 1, 2, 2 };
+
+  SBM weighted_sbm { { "node" }, 42 };
+  SBM repeated_sbm { { "node" }, 42 };
+  for (const auto& id : ids) {
+    weighted_sbm.add_node(id, "node");
+    repeated_sbm.add_node(id, "node");
+  }
+
+  weighted_sbm.add_edges(edges_a, edges_b, {}, {}, weights);
+
+  // Repeats added interleaved with other edges
+  for (int rep = 0; rep < 5; rep++) {
+    for (int i = 0; i < edges_a.size(); i++) {
+      if (rep < weights[i]) repeated_sbm.add_edge(edges_a[i], edges_b[i]);
+    }
+  }
+
+  REQUIRE(weighted_sbm.n_edges() == 20);
+  REQUIRE(repeated_sbm.n_edges() == 20);
+  REQUIRE_THROWS(weighted_sbm.add_edge("n1", "n6", 0));
+
+  // Each neighbor is stored once with its edge count
+  Node* n2 = weighted_sbm.get_node_by_id("n2");
+  REQUIRE(n2->neighbors_of_type(0).size() == 3);
+  REQUIRE(repeated_sbm.get_node_by_id("n2")->neighbors_of_type(0).size() == 3);
+  REQUIRE(n2->degree() == 3 + 5 + 2 * 2);
+  REQUIRE(n2->self_edge_count() == 4);
+
+  for (const auto& id : ids) {
+    REQUIRE(weighted_sbm.get_node_by_id(id)->degree() == repeated_sbm.get_node_by_id(id)->degree());
+  }
+
+  weighted_sbm.initialize_blocks(3);
+  repeated_sbm.initialize_blocks(3);
+  REQUIRE(weighted_sbm.entropy(0) == Approx(repeated_sbm.entropy(0)));
+
+  // Blocks carry the weights along
+  for (const auto& block : weighted_sbm.get_nodes_at_level(1)[0]) {
+    int degree_of_children = 0;
+    for (const Node* child : block->children()) degree_of_children += child->degree();
+    REQUIRE(block->degree() == degree_of_children);
+  }
+
+  // Copies keep weights, self-edges included
+  const auto copy = weighted_sbm.clone(7);
+  REQUIRE(copy->n_edges() == 20);
+  REQUIRE(copy->get_node_by_id("n2")->self_edge_count() == 4);
+  REQUIRE(copy->entropy(0) == Approx(weighted_sbm.entropy(0)));
+
+  // Sweeps keep block degrees and entropy deltas in step with the weights
+  const double pre_entropy = weighted_sbm.entropy(0);
+  const auto sweep_res     = weighted_sbm.mcmc_sweep(10, 0.1, false, false, 0);
+  REQUIRE(weighted_sbm.entropy(0) - pre_entropy == Approx(sweep_res.entropy_delta).margin(1e-6));
+
+  // Merged away blocks give up their degree before being reused
+  const auto blocks = weighted_sbm.get_flat_level(1);
+  weighted_sbm.merge_blocks(blocks[0], blocks[1]);
+  int merged_degree = 0;
+  for (const Node* child : blocks[1]->children()) merged_degree += child->degree();
+  REQUIRE(blocks[1]->degree() == merged_degree);
+  REQUIRE(weighted_sbm.add_block_node(0, 1)->degree() == 0);
+}
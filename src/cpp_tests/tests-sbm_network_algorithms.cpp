@@ -201,3 +201,77 @@ TEST_CASE("Simple entropy calculation (unipartite)", "[SBM")
   // Hand calculated
   REQUIRE(my_sbm.entropy(0) == Approx(6.433708).epsilon(0.1));
 }
+
+TEST_CASE("Sparse interblock edge counts match pair counts", "[SBM]")
+{
+  auto my_sbm = simple_unipartite();
+
+  // Move a node so counts come from maintained structure, not initial build
+  my_sbm.get_node_by_id("n4")->set_parent(my_sbm.get_node_by_id("n6")->parent());
+
+  const auto pair_counts   = my_sbm.interblock_edge_counts(1);
+  const auto sparse_counts = my_sbm.sparse_interblock_edge_counts(1);
+
+  REQUIRE(sparse_counts.block_ids.size() == 3);
+  REQUIRE(sparse_counts.n_edges.size() == pair_counts.size());
+
+  std::map<string, const Node*> blocks_by_id;
+  for (const auto& block : my_sbm.get_nodes_of_type(0, 1)) blocks_by_id[block->id()] = block.get();
+
+  int total_edges = 0;
+  for (int i = 0; i < sparse_counts.n_edges.size(); i++) {
+    REQUIRE(sparse_counts.block_a[i] <= sparse_counts.block_b[i]);
+
+    const Node* block_a = blocks_by_id.at(sparse_counts.block_ids[sparse_counts.block_a[i]]);
+    const Node* block_b = blocks_by_id.at(sparse_counts.block_ids[sparse_counts.block_b[i]]);
+
+    REQUIRE(pair_counts.at(Const_Node_Pair(block_a, block_b)) == sparse_counts.n_edges[i]);
+    total_edges += sparse_counts.n_edges[i];
+  }
+
+  REQUIRE(total_edges == my_sbm.n_edges());
+}
+
+TEST_CASE("Entropy log tables match direct calculation", "[SBM]")
+{
+  reserve_log_tables(500);
+
+  // Inside and past the end of the tables
+  for (const int n : { 1, 2, 17, 499, 500, 5000000 }) {
+    REQUIRE(log_n(n) == Approx(std::log(double(n))));
+    REQUIRE(n_log_n(n) == Approx(n * std::log(double(n))));
+    REQUIRE(lgamma_n_plus_1(n) == Approx(std::lgamma(n + 1.0)));
+  }
+  REQUIRE(n_log_n(0) == 0);
+
+  REQUIRE(ent(3, 10, 7) == Approx(3 * std::log(3.0 / (10.0 * 7.0))));
+
+  // Batches sum the same terms and handle empty blocks
+  const std::vector<int> e_rs { 3, 1, 8 };
+  const std::vector<int> e_s { 7, 12, 9 };
+  REQUIRE(ent_sum(e_rs, e_s, 10) == Approx(ent(3, 10, 7) + ent(1, 10, 12) + ent(8, 10, 9)));
+  REQUIRE(ent_sum({}, {}, 0) == 0);
+}
+
+TEST_CASE("Batch move scoring matches one at a time scoring", "[SBM]")
+{
+  auto my_sbm = planted_unipartite(3, 10, 0.5, 0.1);
+  my_sbm.initialize_blocks(5);
+
+  const auto blocks = my_sbm.get_flat_level(1);
+
+  for (Node* node : my_sbm.get_flat_level(0)) {
+    const int n_possible = my_sbm.n_possible_neighbor_blocks(node);
+    const auto batch_res = get_move_results(node, blocks, n_possible, 0.2);
+
+    REQUIRE(batch_res.size() == blocks.size());
+    for (int i = 0; i < blocks.size(); i++) {
+      const auto single_res = get_move_results(node, blocks[i], n_possible, 0.2);
+      REQUIRE(batch_res[i].entropy_delta == Approx(single_res.entropy_delta));
+      REQUIRE(batch_res[i].prob_ratio == Approx(single_res.prob_ratio));
+
+      // Staying put is free
+      if (blocks[i] == node->parent()) REQUIRE(batch_res[i].entropy_delta == 0);
+    }
+  }
+}
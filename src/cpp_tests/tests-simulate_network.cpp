@@ -0,0 +1,138 @@
+#include "../simulate_network.h"
+#include "catch.hpp"
+
+inline int total_edges(const Simulated_Network& network)
+{
+  return std::accumulate(network.n_edges.begin(), network.n_edges.end(), 0);
+}
+
+TEST_CASE("Simulated edge counts match their expectation", "[Simulation]")
+{
+  Sampler sampler(42);
+
+  // Two blocks of 200 nodes, dense within and sparse between
+  const std::vector<string> names { "a", "b" };
+  const std::vector<int> sizes { 200, 200 };
+  const std::vector<int> block_a { 0, 0, 1 };
+  const std::vector<int> block_b { 0, 1, 1 };
+  const std::vector<double> props { 0.2, 0.01, 0.1 };
+
+  for (const bool self_edges : { true, false }) {
+    const double within_pairs  = self_edges ? 200 * 201 / 2 : 200 * 199 / 2;
+    const double expected      = within_pairs * (0.2 + 0.1) + 200 * 200 * 0.01;
+    const auto bernoulli_net   = simulate_sbm(names, sizes, block_a, block_b, props, bernoulli_edges, self_edges, sampler);
+    const auto poisson_net     = simulate_sbm(names, sizes, block_a, block_b, props, poisson_edges, self_edges, sampler);
+
+    REQUIRE(total_edges(bernoulli_net) == Approx(expected).epsilon(0.05));
+    REQUIRE(total_edges(poisson_net) == Approx(expected).epsilon(0.05));
+
+    // Bernoulli draws never repeat a pair and self edges only show up when allowed
+    REQUIRE(bernoulli_net.n_edges.size() == total_edges(bernoulli_net));
+    for (int e = 0; e < poisson_net.n_edges.size(); e++) {
+      REQUIRE(poisson_net.edges_a[e] <= poisson_net.edges_b[e]);
+      if (!self_edges) REQUIRE(poisson_net.edges_a[e] != poisson_net.edges_b[e]);
+    }
+  }
+}
+
+TEST_CASE("Certain edges give complete graphs", "[Simulation]")
+{
+  Sampler sampler(42);
+  const std::vector<string> names { "a", "b" };
+  const std::vector<int> sizes { 5, 4 };
+
+  // Within block only
+  const auto with_self = simulate_sbm(names, sizes, { 0 }, { 0 }, { 1.0 }, bernoulli_edges, true, sampler);
+  const auto no_self   = simulate_sbm(names, sizes, { 0 }, { 0 }, { 1.0 }, bernoulli_edges, false, sampler);
+  REQUIRE(total_edges(with_self) == 15);
+  REQUIRE(total_edges(no_self) == 10);
+
+  // Between blocks only
+  const auto between = simulate_sbm(names, sizes, { 0 }, { 1 }, { 1.0 }, bernoulli_edges, false, sampler);
+  REQUIRE(total_edges(between) == 20);
+  for (int e = 0; e < between.n_edges.size(); e++) {
+    REQUIRE(between.node_blocks[between.edges_a[e]] != between.node_blocks[between.edges_b[e]]);
+  }
+
+  REQUIRE(with_self.node_ids.size() == 9);
+  REQUIRE(with_self.node_ids[0] == "a_1");
+  REQUIRE(with_self.node_ids[8] == "b_4");
+}
+
+TEST_CASE("Same seed gives the same network", "[Simulation]")
+{
+  const auto simulate = [](const int seed) {
+    Sampler sampler(seed);
+    return simulate_sbm({ "a", "b" }, { 30, 30 }, { 0, 0 }, { 0, 1 }, { 0.3, 0.05 }, poisson_edges, false, sampler);
+  };
+
+  const auto net_1 = simulate(7);
+  const auto net_2 = simulate(7);
+  REQUIRE(net_1.edges_a == net_2.edges_a);
+  REQUIRE(net_1.edges_b == net_2.edges_b);
+  REQUIRE(net_1.n_edges == net_2.n_edges);
+}
+
+TEST_CASE("Degree weights shape simulated degrees", "[Simulation]")
+{
+  Sampler sampler(42);
+
+  // First half of the nodes are four times as heavy as the second half
+  const int n = 400;
+  std::vector<double> weights(n, 1.0);
+  for (int i = 0; i < n / 2; i++) weights[i] = 4.0;
+
+  for (const auto dist : { poisson_edges, bernoulli_edges }) {
+    const auto network = simulate_sbm({ "a" }, { n }, { 0 }, { 0 }, { 0.02 }, dist, false, sampler, weights);
+
+    std::vector<int> degrees(n, 0);
+    for (int e = 0; e < network.n_edges.size(); e++) {
+      degrees[network.edges_a[e]] += network.n_edges[e];
+      degrees[network.edges_b[e]] += network.n_edges[e];
+    }
+    const double heavy = std::accumulate(degrees.begin(), degrees.begin() + n / 2, 0.0);
+    const double light = std::accumulate(degrees.begin() + n / 2, degrees.end(), 0.0);
+
+    // Poisson degrees follow the weights exactly on average, capping pairs at
+    // one edge pulls the heavy nodes down a bit
+    REQUIRE(heavy / light == Approx(4.0).epsilon(dist == poisson_edges ? 0.1 : 0.25));
+  }
+
+  // Weights are normalized within blocks so the edge total keeps its meaning
+  const auto unweighted = simulate_sbm({ "a" }, { n }, { 0 }, { 0 }, { 0.02 }, poisson_edges, true, sampler);
+  const auto weighted   = simulate_sbm({ "a" }, { n }, { 0 }, { 0 }, { 0.02 }, poisson_edges, true, sampler, weights);
+  REQUIRE(total_edges(weighted) == Approx(total_edges(unweighted)).epsilon(0.1));
+
+  REQUIRE_THROWS(simulate_sbm({ "a" }, { n }, { 0 }, { 0 }, { 0.02 }, poisson_edges, true, sampler, { 1.0, 2.0 }));
+}
+
+TEST_CASE("Simulated networks load straight into a model", "[Simulation]")
+{
+  Sampler sampler(42);
+
+  // Bipartite: only edges between the two types
+  const std::vector<string> names { "a", "b", "c", "d" };
+  const std::vector<string> types { "user", "user", "item", "item" };
+  const auto network = simulate_sbm(names,
+                                    { 20, 20, 15, 15 },
+                                    { 0, 0, 1, 1 },
+                                    { 2, 3, 2, 3 },
+                                    { 0.5, 0.05, 0.05, 0.5 },
+                                    poisson_edges,
+                                    false,
+                                    sampler);
+  for (int e = 0; e < network.n_edges.size(); e++) {
+    REQUIRE(types[network.node_blocks[network.edges_a[e]]] != types[network.node_blocks[network.edges_b[e]]]);
+  }
+
+  auto my_sbm = simulated_sbm(network, types, 42);
+  REQUIRE(my_sbm.n_nodes() == 70);
+  REQUIRE(my_sbm.n_types() == 2);
+  REQUIRE(my_sbm.n_nodes_of_type("user") == 40);
+  REQUIRE(my_sbm.n_edges() == total_edges(network));
+
+  // Ready for fitting, with blocks made per type
+  my_sbm.initialize_blocks(2);
+  REQUIRE(my_sbm.n_nodes_at_level(1) == 4);
+  REQUIRE_NOTHROW(my_sbm.mcmc_sweep(1, 0.1, false, false, 0));
+}
@@ -0,0 +1,497 @@
+#pragma once
+// Dense edge-count matrix for when a level only has a handful of blocks. Move
+// and merge entropy deltas become passes over whole matrix rows which are run
+// through SIMD kernels picked at runtime for the CPU (AVX2, then SSE2, then a
+// plain scalar loop).
+
+#include <unordered_map>
+
+#include "Node.h"
+#include "get_move_results.h"
+#include "model_helpers.h"
+#include "partition_arrays.h"
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define SBMR_DENSE_X86 1
+#include <immintrin.h>
+#endif
+
+// Levels with at most this many blocks get the dense backend
+const int DENSE_BLOCK_THRESHOLD = 512;
+
+// =============================================================================
+// Row kernels
+// =============================================================================
+// Sums over a row of edge counts e_t (or the sum of two rows when row_b is
+// given) needed for that row's entropy terms: sum(e_t*log(e_t)),
+// sum(e_t*log(d_t)), and sum(e_t). n_log_n is the lookup table and must cover
+// every count in the rows.
+struct Row_Sums {
+  double x_log_x = 0.0;
+  double x_log_d = 0.0;
+  long total     = 0;
+};
+
+using Row_Kernel = Row_Sums (*)(const int* row_a,
+                                const int* row_b,
+                                const double* log_d,
+                                const double* n_log_n,
+                                const int n);
+
+inline Row_Sums row_sums_scalar(const int* row_a,
+                                const int* row_b,
+                                const double* log_d,
+                                const double* n_log_n,
+                                const int n)
+{
+  Row_Sums sums;
+  for (int t = 0; t < n; t++) {
+    const int e_t = row_b ? row_a[t] + row_b[t] : row_a[t];
+    sums.x_log_x += n_log_n[e_t];
+    sums.x_log_d += e_t * log_d[t];
+    sums.total += e_t;
+  }
+  return sums;
+}
+
+#ifdef SBMR_DENSE_X86
+__attribute__((target("sse2"))) inline Row_Sums row_sums_sse2(const int* row_a,
+                                                              const int* row_b,
+                                                              const double* log_d,
+                                                              const double* n_log_n,
+                                                              const int n)
+{
+  __m128d x_log_x = _mm_setzero_pd();
+  __m128d x_log_d = _mm_setzero_pd();
+  __m128i total   = _mm_setzero_si128();
+
+  int t = 0;
+  for (; t + 2 <= n; t += 2) {
+    __m128i e_t = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row_a + t));
+    if (row_b) e_t = _mm_add_epi32(e_t, _mm_loadl_epi64(reinterpret_cast<const __m128i*>(row_b + t)));
+
+    // No gather before AVX2 so table loads are done one at a time
+    const int e_0 = _mm_cvtsi128_si32(e_t);
+    const int e_1 = _mm_cvtsi128_si32(_mm_srli_si128(e_t, 4));
+
+    x_log_x = _mm_add_pd(x_log_x, _mm_set_pd(n_log_n[e_1], n_log_n[e_0]));
+    x_log_d = _mm_add_pd(x_log_d, _mm_mul_pd(_mm_cvtepi32_pd(e_t), _mm_loadu_pd(log_d + t)));
+    total   = _mm_add_epi32(total, e_t);
+  }
+
+  double x_log_x_lanes[2], x_log_d_lanes[2];
+  int total_lanes[4];
+  _mm_storeu_pd(x_log_x_lanes, x_log_x);
+  _mm_storeu_pd(x_log_d_lanes, x_log_d);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(total_lanes), total);
+
+  Row_Sums sums = row_sums_scalar(row_a + t, row_b ? row_b + t : nullptr, log_d + t, n_log_n, n - t);
+  sums.x_log_x += x_log_x_lanes[0] + x_log_x_lanes[1];
+  sums.x_log_d += x_log_d_lanes[0] + x_log_d_lanes[1];
+  sums.total += long(total_lanes[0]) + total_lanes[1];
+  return sums;
+}
+
+__attribute__((target("avx2"))) inline Row_Sums row_sums_avx2(const int* row_a,
+                                                              const int* row_b,
+                                                              const double* log_d,
+                                                              const double* n_log_n,
+                                                              const int n)
+{
+  __m256d x_log_x = _mm256_setzero_pd();
+  __m256d x_log_d = _mm256_setzero_pd();
+  __m128i total   = _mm_setzero_si128();
+
+  // Masked gather with every lane on: the unmasked intrinsic leaves its pass
+  // through operand undefined, which GCC flags as maybe-uninitialized
+  const __m256d all_lanes = _mm256_castsi256_pd(_mm256_set1_epi64x(-1));
+
+  int t = 0;
+  for (; t + 4 <= n; t += 4) {
+    __m128i e_t = _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_a + t));
+    if (row_b) e_t = _mm_add_epi32(e_t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(row_b + t)));
+
+    x_log_x = _mm256_add_pd(x_log_x, _mm256_mask_i32gather_pd(_mm256_setzero_pd(), n_log_n, e_t, all_lanes, 8));
+    x_log_d = _mm256_add_pd(x_log_d, _mm256_mul_pd(_mm256_cvtepi32_pd(e_t), _mm256_loadu_pd(log_d + t)));
+    total   = _mm_add_epi32(total, e_t);
+  }
+
+  double x_log_x_lanes[4], x_log_d_lanes[4];
+  int total_lanes[4];
+  _mm256_storeu_pd(x_log_x_lanes, x_log_x);
+  _mm256_storeu_pd(x_log_d_lanes, x_log_d);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(total_lanes), total);
+
+  Row_Sums sums = row_sums_scalar(row_a + t, row_b ? row_b + t : nullptr, log_d + t, n_log_n, n - t);
+  for (int i = 0; i < 4; i++) {
+    sums.x_log_x += x_log_x_lanes[i];
+    sums.x_log_d += x_log_d_lanes[i];
+    sums.total += total_lanes[i];
+  }
+  return sums;
+}
+#endif
+
+// Best kernel this CPU supports. Chosen once per process.
+inline Row_Kernel dense_row_kernel()
+{
+  static const Row_Kernel kernel = []() -> Row_Kernel {
+#ifdef SBMR_DENSE_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) return row_sums_avx2;
+    if (__builtin_cpu_supports("sse2")) return row_sums_sse2;
+#endif
+    return row_sums_scalar;
+  }();
+  return kernel;
+}
+
+inline string dense_row_kernel_name()
+{
+#ifdef SBMR_DENSE_X86
+  if (dense_row_kernel() == row_sums_avx2) return "avx2";
+  if (dense_row_kernel() == row_sums_sse2) return "sse2";
+#endif
+  return "scalar";
+}
+
+// =============================================================================
+// Dense block edge counts
+// =============================================================================
+// Snapshot of the edge counts between all blocks of a level, laid out as a
+// square matrix with internal edges counted twice on the diagonal (same
+// convention as the blocks' own maps). Entropy deltas follow the same terms as
+// get_move_results() and merge_entropy_delta(). Accepted moves are committed
+// so the matrix can be reused for a whole sweep as long as no blocks are added
+// or removed. Nodes whose moves are scored must not change blocks except
+// through a committed move.
+class Dense_Block_Counts {
+  private:
+  int _n_blocks = 0;
+  int _stride   = 0; // Row length padded to a multiple of 4 for the kernels
+  std::unordered_map<const Node*, int> _index;
+  std::vector<int> _counts;
+  std::vector<int> _degrees;
+  std::vector<double> _log_degrees; // log of block degree, 0 for empty blocks
+  Row_Kernel _kernel = dense_row_kernel();
+
+  // Node whose counts to blocks are loaded for scoring moves
+  const Node* _loaded_node = nullptr;
+  int _node_degree         = 0;
+  int _self_edges          = 0;
+  std::vector<std::pair<int, int>> _node_counts;
+  std::vector<int> _count_slot; // Scratch for gathering counts from partition arrays
+
+  // Post move rows of old (r) and new (s) blocks for the last scored move
+  const Node* _rows_node = nullptr;
+  int _old_i             = -1;
+  int _new_i             = -1;
+  std::vector<int> _old_row;
+  std::vector<int> _new_row;
+
+  int* row(const int r) { return _counts.data() + r * _stride; }
+  const int* row(const int r) const { return _counts.data() + r * _stride; }
+
+  void set_degree(const int r, const int degree)
+  {
+    _degrees[r]     = degree;
+    _log_degrees[r] = degree == 0 ? 0.0 : log_n(degree);
+  }
+
+  // Zero counts drop out of the entropy (and avoid 0*log(0) for empty blocks)
+  static double pair_ent(const int e_rs, const int e_r, const int e_s)
+  {
+    return e_rs == 0 ? 0.0 : ent(e_rs, e_r, e_s);
+  }
+
+  // Sum of ent(e_rt, d_r, d_t) over every block t
+  double row_ent(const int* r_row, const int r_degree) const
+  {
+    const Row_Sums sums = _kernel(r_row,
+                                  nullptr,
+                                  _log_degrees.data(),
+                                  current_log_tables().load(std::memory_order_acquire)->n_log_n.data(),
+                                  _stride);
+    return sums.total == 0 ? 0.0 : sums.x_log_x - sums.total * log_n(r_degree) - sums.x_log_d;
+  }
+
+  // Entropy terms touched by moving nodes between blocks r and s
+  double pair_partial(const int* r_row, const int r, const int* s_row, const int s) const
+  {
+    const int r_degree = _degrees[r];
+    const int s_degree = _degrees[s];
+    return row_ent(s_row, s_degree) - pair_ent(s_row[s], s_degree, s_degree) / 2
+        + row_ent(r_row, r_degree) - pair_ent(r_row[s], r_degree, s_degree)
+        - pair_ent(r_row[r], r_degree, r_degree) / 2;
+  }
+
+  // Rows of old (r) and new (s) blocks after loaded node moves from r to s
+  void build_post_rows(const int r, const int s)
+  {
+    _rows_node = _loaded_node;
+    _old_i     = r;
+    _new_i     = s;
+
+    std::copy(row(r), row(r) + _stride, _old_row.begin());
+    std::copy(row(s), row(s) + _stride, _new_row.begin());
+
+    // Self edges are in the count to r but move with the node
+    _new_row[s] += _self_edges;
+    _old_row[r] -= _self_edges;
+
+    for (const auto& t_count : _node_counts) {
+      const int t = t_count.first;
+      const int e = t_count.second;
+      if (t == s) {
+        _new_row[s] += 2 * e;
+        _new_row[r] -= e;
+        _old_row[s] -= e;
+      } else if (t == r) {
+        _new_row[r] += e - _self_edges;
+        _old_row[s] += e - _self_edges;
+        _old_row[r] -= 2 * (e - _self_edges);
+      } else {
+        _new_row[t] += e;
+        _old_row[t] -= e;
+      }
+    }
+  }
+
+  // Move of the loaded node from block r to block s
+  Move_Results score_loaded(const int r,
+                            const int s,
+                            const int n_possible_neighbors,
+                            const double eps,
+                            const double beta)
+  {
+    const double epsB = eps * n_possible_neighbors;
+
+    const double pre_move_ent = pair_partial(row(r), r, row(s), s);
+
+    double prob_move_to_new = 0.0;
+    for (const auto& t_count : _node_counts) {
+      const int t = t_count.first;
+      prob_move_to_new += double(t_count.second) / _node_degree
+          * (row(s)[t] + eps) / (_degrees[t] + epsB);
+    }
+
+    build_post_rows(r, s);
+
+    const int old_r_degree = _degrees[r];
+    const int old_s_degree = _degrees[s];
+    set_degree(r, old_r_degree - _node_degree);
+    set_degree(s, old_s_degree + _node_degree);
+
+    const double post_move_ent = pair_partial(_old_row.data(), r, _new_row.data(), s);
+
+    double prob_return_to_old = 0.0;
+    for (const auto& t_count : _node_counts) {
+      const int t = t_count.first;
+      prob_return_to_old += double(t_count.second) / _node_degree
+          * (_old_row[t] + eps) / (_degrees[t] + epsB);
+    }
+
+    set_degree(r, old_r_degree);
+    set_degree(s, old_s_degree);
+
+    return Move_Results(pre_move_ent - post_move_ent,
+                        prob_return_to_old / prob_move_to_new,
+                        beta);
+  }
+
+  void commit_loaded(const int r, const int s)
+  {
+    // Reuse the post move rows if this was the last move scored
+    if (_rows_node != _loaded_node || _old_i != r || _new_i != s) build_post_rows(r, s);
+
+    std::copy(_old_row.begin(), _old_row.end(), row(r));
+    std::copy(_new_row.begin(), _new_row.end(), row(s));
+    for (int t = 0; t < _n_blocks; t++) {
+      row(t)[r] = _old_row[t];
+      row(t)[s] = _new_row[t];
+    }
+
+    set_degree(r, _degrees[r] - _node_degree);
+    set_degree(s, _degrees[s] + _node_degree);
+
+    // Counts of every node to the two blocks may have changed
+    _loaded_node = nullptr;
+    _rows_node   = nullptr;
+  }
+
+  public:
+  Dense_Block_Counts() = default;
+
+  explicit Dense_Block_Counts(const Node_Vec& blocks)
+      : _n_blocks(blocks.size())
+      , _stride((blocks.size() + 3) / 4 * 4)
+      , _counts(_stride * _n_blocks, 0)
+      , _degrees(_stride, 0)
+      , _log_degrees(_stride, 0.0)
+      , _count_slot(_stride, -1)
+      , _old_row(_stride, 0)
+      , _new_row(_stride, 0)
+  {
+    _index.reserve(_n_blocks);
+    for (int r = 0; r < _n_blocks; r++) _index[blocks[r]] = r;
+
+    long total_degree = 0;
+    for (int r = 0; r < _n_blocks; r++) {
+      int* r_row = row(r);
+      for (const auto& block_count : blocks[r]->block_edges()) {
+        r_row[_index.at(block_count.first)] = block_count.second;
+      }
+      set_degree(r, blocks[r]->degree());
+      total_degree += _degrees[r];
+    }
+
+    // Kernels read the table directly so it has to cover every count
+    reserve_log_tables(total_degree);
+  }
+
+  int n_blocks() const { return _n_blocks; }
+
+  int index(const Node* block) const { return _index.at(block); }
+
+  // Counts of block r to every block, in the order blocks were given
+  const int* counts_row(const int r) const { return row(r); }
+
+  int edges_between(const Node* block_a, const Node* block_b) const
+  {
+    return row(index(block_a))[index(block_b)];
+  }
+
+  // Counts of node to blocks. Gathered once and reused for any number of
+  // moves of the node until a move gets committed.
+  void load_node(const Node* node)
+  {
+    if (node == _loaded_node) return;
+
+    _loaded_node = node;
+    _node_degree = node->degree();
+    _self_edges  = node->self_edge_count();
+    _node_counts.clear();
+    for (const auto& block_count : node->gather_neighbors_at_level(node->level() + 1)) {
+      _node_counts.emplace_back(index(block_count.first), block_count.second);
+    }
+  }
+
+  // Same from the arrays of a partition whose blocks are those of the matrix
+  // in the same order. The arrays' node i has to be at its current block.
+  void load_node(const Partition_Arrays& partition, const int i)
+  {
+    const Node* node = partition.node(i);
+    if (node == _loaded_node) return;
+
+    _loaded_node = node;
+    _node_degree = partition.degree[i];
+    _self_edges  = partition.self_edges[i];
+    _node_counts.clear();
+    for (int e = partition.edge_start[i]; e < partition.edge_start[i + 1]; e++) {
+      const int t = partition.block_of[partition.edge_to[e]];
+      if (_count_slot[t] < 0) {
+        _count_slot[t] = _node_counts.size();
+        _node_counts.emplace_back(t, 0);
+      }
+      _node_counts[_count_slot[t]].second += partition.edge_weight[e];
+    }
+    for (const auto& t_count : _node_counts) _count_slot[t_count.first] = -1;
+  }
+
+  // Same as get_move_results() but with block counts read from matrix rows
+  Move_Results move_results(const Node* node,
+                            const Node* new_block,
+                            const int n_possible_neighbors,
+                            const double eps  = 0.1,
+                            const double beta = 1.0)
+  {
+    const Node* old_block = node->parent();
+    if (new_block == old_block) return Move_Results(0, 1);
+
+    load_node(node);
+    return score_loaded(index(old_block), index(new_block), n_possible_neighbors, eps, beta);
+  }
+
+  // Move of the partition's node i to block s
+  Move_Results move_results(const Partition_Arrays& partition,
+                            const int i,
+                            const int s,
+                            const int n_possible_neighbors,
+                            const double eps  = 0.1,
+                            const double beta = 1.0)
+  {
+    const int r = partition.block_of[i];
+    if (r == s) return Move_Results(0, 1);
+
+    load_node(partition, i);
+    return score_loaded(r, s, n_possible_neighbors, eps, beta);
+  }
+
+  std::vector<Move_Results> move_results(const Node* node,
+                                         const Node_Vec& candidates,
+                                         const int n_possible_neighbors,
+                                         const double eps  = 0.1,
+                                         const double beta = 1.0)
+  {
+    std::vector<Move_Results> results;
+    results.reserve(candidates.size());
+    for (const Node* candidate : candidates) {
+      results.push_back(move_results(node, candidate, n_possible_neighbors, eps, beta));
+    }
+    return results;
+  }
+
+  // Write a move of node to new_block into the matrix. Must be called before
+  // the node actually changes blocks.
+  void commit_move(const Node* node, const Node* new_block)
+  {
+    load_node(node);
+    const int r = index(node->parent());
+    const int s = index(new_block);
+    if (r != s) commit_loaded(r, s);
+  }
+
+  // Same for the partition's node i, before the arrays are moved
+  void commit_move(const Partition_Arrays& partition, const int i, const int s)
+  {
+    load_node(partition, i);
+    const int r = partition.block_of[i];
+    if (r != s) commit_loaded(r, s);
+  }
+
+  // Same as merge_entropy_delta(): block b is absorbed into block a
+  double merge_entropy_delta(const Node* block_a, const Node* block_b) const
+  {
+    const int a        = index(block_a);
+    const int b        = index(block_b);
+    const int* a_row   = row(a);
+    const int* b_row   = row(b);
+    const int degree_a = _degrees[a];
+    const int degree_b = _degrees[b];
+    const int merged   = degree_a + degree_b;
+
+    const double pre_merge_ent = row_ent(a_row, degree_a) - pair_ent(a_row[a], degree_a, degree_a) / 2
+        + row_ent(b_row, degree_b) - pair_ent(b_row[a], degree_b, degree_a)
+        - pair_ent(b_row[b], degree_b, degree_b) / 2;
+
+    // Merged row over every block, then pull out the a and b columns which
+    // collapse into the merged block's internal count
+    Row_Sums sums = _kernel(a_row,
+                            b_row,
+                            _log_degrees.data(),
+                            current_log_tables().load(std::memory_order_acquire)->n_log_n.data(),
+                            _stride);
+    for (const int t : { a, b }) {
+      const int e_t = a_row[t] + b_row[t];
+      sums.x_log_x -= n_log_n(e_t);
+      sums.x_log_d -= e_t * _log_degrees[t];
+      sums.total -= e_t;
+    }
+    const int merged_internal = a_row[a] + b_row[a] + a_row[b] + b_row[b];
+
+    const double post_merge_ent = (sums.total == 0 ? 0.0 : sums.x_log_x - sums.total * log_n(merged) - sums.x_log_d)
+        + pair_ent(merged_internal, merged, merged) / 2;
+
+    return pre_merge_ent - post_merge_ent;
+  }
+};
@@ -5,14 +5,34 @@
 // We swap out some commonly used error and message funtions depending on if this
 // code is being compiled with RCPP available or not. When RCPP is being used ot
 // compile the code these functions make sure messages are properly passed to R.
+#include <exception>
+#include <stdexcept>
+#include <string>
+
+// True on threads the model starts for itself (replica exchange, background
+// jobs). Nothing there may touch R, so errors are thrown as plain std
+// exceptions and handed back with rethrow_worker_error() on the thread that
+// collects the work.
+inline bool& on_worker_thread()
+{
+  static thread_local bool worker = false;
+  return worker;
+}
+
 // #if NO_RCPP
 #ifndef BEGIN_RCPP
 #include <iostream>
+#include <vector>
 #define LOGIC_ERROR(msg) throw std::logic_error(msg)
 #define RANGE_ERROR(msg) throw std::range_error(msg)
 #define WARN_ABOUT(msg) std::cerr << std::string(msg) << std::endl
 #define OUT_MSG std::cout
-#define ALLOW_USER_BREAKOUT
+#define ALLOW_USER_BREAKOUT do { } while (0)
+
+inline void rethrow_worker_error(const std::exception_ptr& error)
+{
+  std::rethrow_exception(error);
+}
 
 using InOut_String_Vec = std::vector<std::string>;
 using InOut_Int_Vec    = std::vector<int>;
@@ -31,13 +51,37 @@ inline const std::vector<std::string>& to_str_vec(const InOut_String_Vec& in_vec
 
 #else
 #include <Rcpp.h>
+
+// Building an Rcpp::exception records a stack trace through the R API so
+// worker threads throw the std equivalent instead
+[[noreturn]] inline void throw_r_error(const std::string& msg)
+{
+  if (on_worker_thread()) throw std::logic_error(msg);
+  throw Rcpp::exception(msg.c_str(), false);
+}
+
 // Eases the process of wrapping functions to get errors forwarded to R
-#define LOGIC_ERROR(msg) throw Rcpp::exception(std::string(msg).c_str(), false)
-#define RANGE_ERROR(msg) throw Rcpp::exception(std::string(msg).c_str(), false)
-#define WARN_ABOUT(msg) Rcpp::warning(std::string(msg).c_str())
+#define LOGIC_ERROR(msg) throw_r_error(std::string(msg))
+#define RANGE_ERROR(msg) throw_r_error(std::string(msg))
+#define WARN_ABOUT(msg)                                                 \
+  do {                                                                  \
+    if (!on_worker_thread()) Rcpp::warning(std::string(msg).c_str());   \
+  } while (0)
 #define OUT_MSG Rcpp::Rcout
 #define ALLOW_USER_BREAKOUT Rcpp::checkUserInterrupt()
 
+// Turn an error caught on a worker thread into an R error, from R's thread
+inline void rethrow_worker_error(const std::exception_ptr& error)
+{
+  try {
+    std::rethrow_exception(error);
+  } catch (const Rcpp::exception&) {
+    throw;
+  } catch (const std::exception& e) {
+    throw Rcpp::exception(e.what(), false);
+  }
+}
+
 using InOut_String_Vec = Rcpp::CharacterVector;
 using InOut_Int_Vec    = Rcpp::IntegerVector;
 using InOut_Double_Vec = Rcpp::NumericVector;
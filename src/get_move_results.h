@@ -8,143 +8,224 @@
 #include "Node.h"
 #include "model_helpers.h"
 
-using Node_Edge_Counts = std::map<const Node*, int>;
+using Node_Edge_Counts = std::map<const Node*, int, Creation_Order>;
 using Edge_Count       = std::pair<const Node*, int>;
 
 struct Move_Results {
   double entropy_delta  = 0.0;
   double prob_ratio     = 1.0;
   double prob_of_accept = 0.0;
-  Move_Results(const double& e, const double& p)
+  Move_Results(const double& e, const double& p, const double& beta = 1.0)
       : entropy_delta(e)
       , prob_ratio(p)
-      , prob_of_accept(exp(-e) * p)
+      , prob_of_accept(exp(-beta * e) * p)
   {
   }
 };
 
-inline Move_Results get_move_results(const Node* node,
-                                     const Node* new_block,
-                                     const int n_possible_neighbors,
-                                     const double eps = 0.1)
+// Entropy terms of block r's edges to the blocks in its count map. Edges within
+// r show up at both of their ends so are halved. Counts to skip_block are left
+// out as they get accounted for from that block's side, and zero counts (which
+// may be to a now empty block) add nothing.
+template <typename Degree_Fn>
+inline double block_ent_partial(const Edge_Count_Map& r_counts,
+                                const Node* block_r,
+                                const int r_degree,
+                                const Node* skip_block,
+                                Degree_Fn get_degree)
 {
-  Node* old_block = node->parent();
-
-  // No need to go on if we're "swapping" to the same group
-  if (new_block == old_block)
-    return Move_Results(0, 1);
-
-  // These stay constant before and after move
-  const int block_level     = node->level() + 1;
-  const double& node_degree = node->degree();
-  const double epsB         = eps * n_possible_neighbors;
-
-  // These will change before and after move
-  double new_block_degree = new_block->degree();
-  double old_block_degree = old_block->degree();
-
-  // Gather up all the edges for both the node being moved and its old and new blocks
-  Edge_Count_Map node_neighbor_counts      = node->gather_neighbors_at_level(block_level);
-  Edge_Count_Map new_block_neighbor_counts = new_block->gather_neighbors_at_level(block_level);
-  Edge_Count_Map old_block_neighbor_counts = old_block->gather_neighbors_at_level(block_level);
-
-  auto get_block_degree = [&](const Node* block_t) {
-    return block_t == old_block
-        ? old_block_degree
-        : block_t == new_block
-            ? new_block_degree
-            : block_t->degree();
-  };
-
-  // Get pre move entropy partials from new and old blocks
-  double pre_move_ent = 0.0;
-
-  for (const auto& new_to_t : new_block_neighbor_counts) {
-    const Node* block_t = new_to_t.first;
-    const int t_degree  = get_block_degree(block_t);
-    const double scalar = block_t == new_block ? 2 : 1;
-
-    pre_move_ent += ent(new_to_t.second, new_block_degree, t_degree) / scalar;
+  std::vector<int> e_rs;
+  std::vector<int> e_s;
+  e_rs.reserve(r_counts.size());
+  e_s.reserve(r_counts.size());
+
+  double internal_ent = 0.0;
+  for (const auto& r_to_t : r_counts) {
+    const Node* block_t = r_to_t.first;
+    if (block_t == skip_block || r_to_t.second == 0) continue;
+
+    if (block_t == block_r) {
+      internal_ent = ent(r_to_t.second, r_degree, r_degree) / 2;
+    } else {
+      e_rs.push_back(r_to_t.second);
+      e_s.push_back(get_degree(block_t));
+    }
   }
 
-  for (const auto& old_to_t : old_block_neighbor_counts) {
-    const Node* block_t = old_to_t.first;
-
-    // Don't double count the old-new edge counts
-    if (block_t == new_block) continue;
-
-    const int t_degree  = get_block_degree(block_t);
-    const double scalar = block_t == old_block ? 2 : 1;
+  return ent_sum(e_rs, e_s, r_degree) + internal_ent;
+}
 
-    pre_move_ent += ent(old_to_t.second, old_block_degree, t_degree) / scalar;
+// Scores moves of a single node to any number of candidate blocks. Everything
+// that only depends on the node and its current block (the node's counts to
+// blocks, and the old block's entropy terms before and after losing the node)
+// is gathered once up front. Each candidate then only costs a pass over its
+// own counts.
+class Node_Move_Scorer {
+  private:
+  const Node* _node;
+  const Node* _old_block;
+  double _eps;
+  double _epsB;
+  int _node_degree;
+  int _self_edges;     // Edges of node to itself, these move with it
+  int _old_degree;     // Old block degree before the move...
+  int _old_degree_post; // ... and after
+  Edge_Count_Map _node_counts;
+  Edge_Count_Map _old_counts;      // Old block's counts to blocks
+  Edge_Count_Map _old_counts_post; // Same with node removed (count to any candidate s not yet adjusted)
+  double _old_pre_ent;   // Entropy terms of old block before move, over all blocks
+  double _old_post_ent;  // Same after move, other blocks keep their pre-move degrees
+  double _return_prob;   // Probability of returning to old block after move, over all blocks
+
+  // Pre move degrees with the old block optionally at its post move degree
+  int degree_of(const Node* block_t, const bool post) const
+  {
+    return block_t == _old_block ? (post ? _old_degree_post : _old_degree) : block_t->degree();
   }
 
-  // Get probability of node moving to new block
-  double prob_move_to_new = 0.0;
-  for (const auto& node_neighbor_count : node_neighbor_counts) {
-    const double t_degree   = get_block_degree(node_neighbor_count.first);
-    const double edges_to_t = new_block_neighbor_counts[node_neighbor_count.first];
+  static int count_to(const Edge_Count_Map& counts, const Node* block)
+  {
+    const auto count_it = counts.find(block);
+    return count_it == counts.end() ? 0 : count_it->second;
+  }
 
-    prob_move_to_new += node_neighbor_count.second / node_degree * (edges_to_t + eps) / (t_degree + epsB);
+  double return_prob_term(const int e_to_t, const int e_old_to_t, const int t_degree) const
+  {
+    return double(e_to_t) / _node_degree * (e_old_to_t + _eps) / (t_degree + _epsB);
   }
 
-  // Update edge count maps for post move
-  for (const auto& node_block_count : node_neighbor_counts) {
-    const Node* block    = node_block_count.first;
-    const int e_to_block = node_block_count.second;
+  public:
+  Node_Move_Scorer(const Node* node, const int n_possible_neighbors, const double eps = 0.1)
+      : _node(node)
+      , _old_block(node->parent())
+      , _eps(eps)
+      , _epsB(eps * n_possible_neighbors)
+      , _node_degree(node->degree())
+      , _self_edges(node->self_edge_count())
+      , _old_degree(_old_block->degree())
+      , _old_degree_post(_old_degree - _node_degree)
+      , _node_counts(node->gather_neighbors_at_level(node->level() + 1))
+      , _old_counts(_old_block->gather_neighbors_at_level(node->level() + 1))
+      , _old_counts_post(_old_counts)
+  {
+    const int e_to_others = count_to(_node_counts, _old_block) - _self_edges;
+
+    for (const auto& node_block_count : _node_counts) {
+      if (node_block_count.first == _old_block) {
+        reduce_edge_count(_old_counts_post, _old_block, 2 * e_to_others + _self_edges);
+      } else {
+        reduce_edge_count(_old_counts_post, node_block_count.first, node_block_count.second);
+      }
+    }
 
-    if (block == new_block) {
-      increase_edge_count(new_block_neighbor_counts, new_block, 2 * e_to_block);
+    const auto pre_degree  = [this](const Node* t) { return degree_of(t, false); };
+    const auto post_degree = [this](const Node* t) { return degree_of(t, true); };
 
-      reduce_edge_count(new_block_neighbor_counts, old_block, e_to_block);
-      reduce_edge_count(old_block_neighbor_counts, new_block, e_to_block);
-    } else if (block == old_block) {
-      increase_edge_count(new_block_neighbor_counts, old_block, e_to_block);
-      increase_edge_count(old_block_neighbor_counts, new_block, e_to_block);
+    _old_pre_ent  = block_ent_partial(_old_counts, _old_block, _old_degree, nullptr, pre_degree);
+    _old_post_ent = block_ent_partial(_old_counts_post, _old_block, _old_degree_post, nullptr, post_degree);
 
-      reduce_edge_count(old_block_neighbor_counts, old_block, 2 * e_to_block);
-    } else {
-      increase_edge_count(new_block_neighbor_counts, block, e_to_block);
-      reduce_edge_count(old_block_neighbor_counts, block, e_to_block);
+    _return_prob = 0.0;
+    for (const auto& node_block_count : _node_counts) {
+      const Node* block_t = node_block_count.first;
+      _return_prob += return_prob_term(node_block_count.second,
+                                       count_to(_old_counts_post, block_t),
+                                       degree_of(block_t, true));
     }
   }
 
-  new_block_degree += node_degree;
-  old_block_degree -= node_degree;
-
-  // Get post move entropy partials from new and old blocks
-  double post_move_ent = 0.0;
-  for (const auto& new_to_t : new_block_neighbor_counts) {
-    const Node* block_t = new_to_t.first;
-
-    const int t_degree  = get_block_degree(new_to_t.first);
-    const double scalar = block_t == new_block ? 2 : 1;
-
-    post_move_ent += ent(new_to_t.second, new_block_degree, t_degree) / scalar;
-  }
+  Move_Results score(const Node* new_block, const double beta = 1.0) const
+  {
+    // No need to go on if we're "swapping" to the same group
+    if (new_block == _old_block) return Move_Results(0, 1);
+
+    const int new_degree      = new_block->degree();
+    const int new_degree_post = new_degree + _node_degree;
+    const int e_to_new        = count_to(_node_counts, new_block);
+    const int e_to_others     = count_to(_node_counts, _old_block) - _self_edges;
+    const int e_old_new       = count_to(_old_counts, new_block);
+    const int e_old_new_post  = e_old_new - e_to_new; // Without the node's edges to its old block
+
+    Edge_Count_Map new_counts = new_block->gather_neighbors_at_level(new_block->level());
+
+    auto pre_degree = [&](const Node* t) {
+      return t == new_block ? new_degree : degree_of(t, false);
+    };
+    auto post_degree = [&](const Node* t) {
+      return t == new_block ? new_degree_post : degree_of(t, true);
+    };
+
+    // Old block's terms were taken over every block, the new block's count
+    // gets covered from the new block's side
+    const double pre_move_ent = block_ent_partial(new_counts, new_block, new_degree, nullptr, pre_degree)
+        + _old_pre_ent - (e_old_new == 0 ? 0.0 : ent(e_old_new, _old_degree, new_degree));
+
+    // Probability of node moving to new block
+    double prob_move_to_new = 0.0;
+    for (const auto& node_block_count : _node_counts) {
+      const Node* block_t = node_block_count.first;
+      prob_move_to_new += double(node_block_count.second) / _node_degree
+          * (count_to(new_counts, block_t) + _eps) / (pre_degree(block_t) + _epsB);
+    }
 
-  for (const auto& old_to_t : old_block_neighbor_counts) {
-    const Node* block_t = old_to_t.first;
+    // Update new block's counts for post move. The node's edges to itself
+    // show up in its count to the old block but travel with it.
+    if (_self_edges > 0) increase_edge_count(new_counts, new_block, _self_edges);
+    for (const auto& node_block_count : _node_counts) {
+      const Node* block    = node_block_count.first;
+      const int e_to_block = node_block_count.second;
+
+      if (block == new_block) {
+        increase_edge_count(new_counts, new_block, 2 * e_to_block);
+        reduce_edge_count(new_counts, _old_block, e_to_block);
+      } else if (block == _old_block) {
+        increase_edge_count(new_counts, _old_block, e_to_others);
+      } else {
+        increase_edge_count(new_counts, block, e_to_block);
+      }
+    }
 
-    // Don't double count the old-new edge counts
-    if (block_t == new_block)
-      continue;
+    const double post_move_ent = block_ent_partial(new_counts, new_block, new_degree_post, nullptr, post_degree)
+        + _old_post_ent - (e_old_new_post == 0 ? 0.0 : ent(e_old_new_post, _old_degree_post, new_degree));
 
-    const int t_degree  = get_block_degree(block_t);
-    const double scalar = block_t == old_block ? 2 : 1;
+    // Probability of node moving back to original block. Swap out the new
+    // block's term as both its degree and count to the old block change.
+    double prob_return_to_old = _return_prob;
+    if (e_to_new > 0) {
+      prob_return_to_old += return_prob_term(e_to_new, e_old_new_post + e_to_others, new_degree_post)
+          - return_prob_term(e_to_new, e_old_new_post, new_degree);
+    }
 
-    post_move_ent += ent(old_to_t.second, old_block_degree, t_degree) / scalar;
+    return Move_Results(pre_move_ent - post_move_ent,
+                        prob_return_to_old / prob_move_to_new,
+                        beta);
   }
 
-  // Get probability of node moving back to original block
-  double prob_return_to_old = 0.0;
-  for (const auto& node_neighbor_count : node_neighbor_counts) {
-    const double t_degree   = get_block_degree(node_neighbor_count.first);
-    const double edges_to_t = old_block_neighbor_counts[node_neighbor_count.first];
-
-    prob_return_to_old += node_neighbor_count.second / node_degree * (edges_to_t + eps) / (t_degree + epsB);
+  std::vector<Move_Results> score(const Node_Vec& candidates, const double beta = 1.0) const
+  {
+    std::vector<Move_Results> results;
+    results.reserve(candidates.size());
+    for (const Node* candidate : candidates) results.push_back(score(candidate, beta));
+    return results;
   }
+};
+
+inline Move_Results get_move_results(const Node* node,
+                                     const Node* new_block,
+                                     const int n_possible_neighbors,
+                                     const double eps  = 0.1,
+                                     const double beta = 1.0)
+{
+  if (new_block == node->parent()) return Move_Results(0, 1);
+  return Node_Move_Scorer(node, n_possible_neighbors, eps).score(new_block, beta);
+}
 
-  return Move_Results(pre_move_ent - post_move_ent,
-                      prob_return_to_old / prob_move_to_new);
+// Batch version for a set of candidate blocks, the node's counts are only
+// gathered once
+inline std::vector<Move_Results> get_move_results(const Node* node,
+                                                  const Node_Vec& candidates,
+                                                  const int n_possible_neighbors,
+                                                  const double eps  = 0.1,
+                                                  const double beta = 1.0)
+{
+  return Node_Move_Scorer(node, n_possible_neighbors, eps).score(candidates, beta);
 }
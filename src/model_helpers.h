@@ -1,26 +1,121 @@
 #pragma once
 
 // Helper functions that get used throughout code
+#include <atomic>
+#include <cmath>
 #include <map>
+#include <memory>
+#include <mutex>
+#include <vector>
 
-inline double ent(const double e_rs, const double e_r, const double e_s)
+// =============================================================================
+// Lookup tables for the log terms of the entropy
+// =============================================================================
+// Every log in the entropy is of an integer edge count or degree, none of which
+// can exceed twice the number of edges. Tables of log(n), n*log(n), and
+// lgamma(n + 1) turn those logs into loads. Tables only grow through
+// reserve_log_tables() (called as edges are added) and are never freed or
+// changed once published, so lookups from sweeps on other threads need no
+// lock. Lookups past the end of the table compute the value directly.
+struct Log_Tables {
+  std::vector<double> log_n;
+  std::vector<double> n_log_n;
+  std::vector<double> lgamma_n_plus_1;
+
+  Log_Tables(const int size)
+      : log_n(size)
+      , n_log_n(size)
+      , lgamma_n_plus_1(size)
+  {
+    for (int n = 0; n < size; n++) {
+      log_n[n]           = std::log(double(n));
+      n_log_n[n]         = n == 0 ? 0.0 : n * log_n[n]; // 0*log(0) taken as 0
+      lgamma_n_plus_1[n] = std::lgamma(n + 1.0);
+    }
+  }
+
+  int size() const { return log_n.size(); }
+};
+
+inline std::atomic<const Log_Tables*>& current_log_tables()
 {
-  // OUT_MSG << "e_rs: " << e_rs
-  //         << ", e_r: " << e_r
-  //         << ", e_s: " << e_s
-  //         << " -> " << e_rs * std::log(e_rs / (e_r * e_s))
-  //         << std::endl;
-  return e_rs * std::log(e_rs / (e_r * e_s));
+  static std::atomic<const Log_Tables*> tables(new Log_Tables(1024));
+  return tables;
 }
 
-template <typename T>
-using Const_Ptr = const T*;
+// Make sure tables cover all integers up to max_n
+inline void reserve_log_tables(const int max_n)
+{
+  if (current_log_tables().load(std::memory_order_acquire)->size() > max_n) return;
+
+  static std::mutex grow_mutex;
+  static std::vector<std::unique_ptr<const Log_Tables>> retired_tables; // Still readable by running sweeps
+
+  std::lock_guard<std::mutex> lock(grow_mutex);
+
+  const Log_Tables* old_tables = current_log_tables().load(std::memory_order_acquire);
+  if (old_tables->size() > max_n) return;
 
-template <typename T>
-using Count_Map = std::map<T, int>;
+  // Grow geometrically so networks built edge by edge don't rebuild every time
+  const Log_Tables* new_tables = new Log_Tables(std::max(2 * old_tables->size(), max_n + 1));
+  current_log_tables().store(new_tables, std::memory_order_release);
+  retired_tables.emplace_back(old_tables);
+}
+
+inline double log_n(const int n)
+{
+  const Log_Tables* tables = current_log_tables().load(std::memory_order_acquire);
+  return n < tables->size() ? tables->log_n[n] : std::log(double(n));
+}
+
+inline double n_log_n(const int n)
+{
+  const Log_Tables* tables = current_log_tables().load(std::memory_order_acquire);
+  return n < tables->size() ? tables->n_log_n[n] : n * std::log(double(n));
+}
 
-template <typename T>
-inline void reduce_edge_count(Count_Map<Const_Ptr<T>>& count_map, Const_Ptr<T> block, const int dec_amt)
+inline double lgamma_n_plus_1(const int n)
+{
+  const Log_Tables* tables = current_log_tables().load(std::memory_order_acquire);
+  return n < tables->size() ? tables->lgamma_n_plus_1[n] : std::lgamma(n + 1.0);
+}
+
+// e_rs*log(e_rs/(e_r*e_s)) split into table lookups
+inline double ent(const int e_rs, const int e_r, const int e_s)
+{
+  return n_log_n(e_rs) - e_rs * (log_n(e_r) + log_n(e_s));
+}
+
+// Sum of ent(e_rs[i], e_r, e_s[i]) for one block r against a batch of blocks.
+// The log(e_r) term is pulled out of the sum and the rest is kept to flat
+// loops over arrays so the adds and multiplies around the loads vectorize.
+inline double ent_sum(const std::vector<int>& e_rs,
+                      const std::vector<int>& e_s,
+                      const int e_r)
+{
+  const Log_Tables* tables = current_log_tables().load(std::memory_order_acquire);
+  const int n              = e_rs.size();
+
+  long total_edges = 0;
+  double sum       = 0.0;
+  for (int i = 0; i < n; i++) {
+    const int e_rs_i = e_rs[i];
+    const int e_s_i  = e_s[i];
+    const bool in_table = e_rs_i < tables->size() && e_s_i < tables->size();
+
+    total_edges += e_rs_i;
+    sum += in_table
+        ? tables->n_log_n[e_rs_i] - e_rs_i * tables->log_n[e_s_i]
+        : n_log_n(e_rs_i) - e_rs_i * log_n(e_s_i);
+  }
+
+  // Empty blocks have no edges (and a degree of 0 whose log would poison the sum)
+  return total_edges == 0 ? sum : sum - total_edges * log_n(e_r);
+}
+
+// Count maps are keyed on block pointers
+template <typename Count_Map>
+inline void reduce_edge_count(Count_Map& count_map, const typename Count_Map::key_type block, const int dec_amt)
 {
   const int new_value = count_map[block] - dec_amt;
   // If we've reduced the value to zero, then remove from map
@@ -31,8 +126,8 @@ inline void reduce_edge_count(Count_Map<Const_Ptr<T>>& count_map, Const_Ptr<T> b
   }
 }
 
-template <typename T>
-inline void increase_edge_count(Count_Map<Const_Ptr<T>>& count_map, Const_Ptr<T> block, const int inc_amt)
+template <typename Count_Map>
+inline void increase_edge_count(Count_Map& count_map, const typename Count_Map::key_type block, const int inc_amt)
 {
   count_map[block] += inc_amt;
-}
\ No newline at end of file
+}
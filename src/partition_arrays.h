@@ -0,0 +1,190 @@
+#pragma once
+// Structure-of-arrays copy of the partition of one level of the model. Node
+// objects keep everything about a node in their own heap allocation, so
+// reading the block of each neighbor in a sweep means a pointer chase into a
+// cold cache line per edge. Here the few fields a sweep reads sit in flat
+// arrays indexed by position: blocks of nodes, degrees, types, and the edges
+// of each node in compressed rows. Moves are made in the arrays first and
+// the Node objects, which stay the model's state for everything else, are
+// brought up to date with sync_nodes() (see SBM::run_sweeps()).
+
+#include "Flat_Hash_Map.h"
+#include "Node.h"
+#include "Sampler.h"
+
+class Partition_Arrays {
+  private:
+  Node_Vec _nodes;
+  Node_Vec _blocks;
+  Flat_Hash_Map<const Node*, int> _node_index;
+
+  // Nodes moved in the arrays since the last sync and the blocks their Node
+  // objects are in
+  std::vector<int> _unsynced;
+  std::vector<char> _is_unsynced;
+  std::vector<int> _synced_block;
+  bool _blocks_on_top = true; // Blocks have no parents of their own
+
+  public:
+  // Nodes of the level, in the order they were given
+  std::vector<int> block_of;
+  std::vector<int> degree;
+  std::vector<int> type;
+  std::vector<int> self_edges; // Counted at both ends, as in Node
+
+  // Edges to other nodes of the level: those of node i are the entries in
+  // [edge_start[i], edge_start[i + 1])
+  std::vector<int> edge_start;
+  std::vector<int> edge_to;
+  std::vector<int> edge_weight;
+
+  // Blocks of the level above, in the order they were given
+  std::vector<int> block_degree;
+  std::vector<int> block_size;
+  std::vector<int> block_type;
+  std::vector<std::vector<int>> blocks_of_type;
+
+  Partition_Arrays() = default;
+
+  // Every node of the level needs a parent in blocks
+  Partition_Arrays(const Node_Vec& nodes, const Node_Vec& blocks, const int n_types)
+      : _nodes(nodes)
+      , _blocks(blocks)
+      , _is_unsynced(nodes.size(), false)
+      , block_of(nodes.size())
+      , degree(nodes.size())
+      , type(nodes.size())
+      , self_edges(nodes.size(), 0)
+      , edge_start(nodes.size() + 1, 0)
+      , block_degree(blocks.size())
+      , block_size(blocks.size())
+      , block_type(blocks.size())
+      , blocks_of_type(n_types)
+  {
+    Flat_Hash_Map<const Node*, int> block_index;
+    block_index.reserve(blocks.size());
+    for (int b = 0; b < blocks.size(); b++) {
+      block_index.emplace(blocks[b], b);
+      block_degree[b] = blocks[b]->degree();
+      block_size[b]   = blocks[b]->n_children();
+      block_type[b]   = blocks[b]->type();
+      blocks_of_type[block_type[b]].push_back(b);
+      if (blocks[b]->has_parent()) _blocks_on_top = false;
+    }
+
+    _node_index.reserve(nodes.size());
+    for (int i = 0; i < nodes.size(); i++) _node_index.emplace(nodes[i], i);
+
+    for (int i = 0; i < nodes.size(); i++) {
+      const Node* node = nodes[i];
+      block_of[i]      = block_index.at(node->parent());
+      degree[i]        = node->degree();
+      type[i]          = node->type();
+
+      // Data nodes keep neighbors, blocks keep counts to the other blocks
+      const auto add_edge = [&](const Node* other, const int weight) {
+        const int j = _node_index.at(other);
+        if (j == i) self_edges[i] += weight;
+        edge_to.push_back(j);
+        edge_weight.push_back(weight);
+      };
+      if (node->level() == 0) {
+        for (const auto& neighbor : node->neighbors()) add_edge(neighbor.node, neighbor.weight);
+      } else {
+        for (const auto& block_count : node->block_edges()) add_edge(block_count.first, block_count.second);
+      }
+      edge_start[i + 1] = edge_to.size();
+    }
+    _synced_block = block_of;
+  }
+
+  int n_nodes() const { return _nodes.size(); }
+  int n_blocks() const { return _blocks.size(); }
+
+  // Node objects behind the arrays
+  Node* node(const int i) const { return _nodes[i]; }
+  Node* block(const int b) const { return _blocks[b]; }
+  const Node_Vec& blocks() const { return _blocks; }
+
+  int index(const Node* node) const { return _node_index.at(node); }
+
+  // Block of the far end of a random one of node i's edges. draw is uniform
+  // on [0, 1).
+  int sample_neighbor_block(const int i, const double draw) const
+  {
+    int edge_i = Sampler::unif_to_int(draw, degree[i] - 1);
+    for (int e = edge_start[i]; e < edge_start[i + 1]; e++) {
+      if (edge_i < edge_weight[e]) return block_of[edge_to[e]];
+      edge_i -= edge_weight[e];
+    }
+    LOGIC_ERROR("Node's degree doesn't match its edges");
+  }
+
+  // Node objects follow at the next sync_nodes() unless node_moved says the
+  // caller already moved node i's Node itself
+  void move(const int i, const int new_block, const bool node_moved = false)
+  {
+    const int old_block = block_of[i];
+    block_degree[old_block] -= degree[i];
+    block_size[old_block]--;
+    block_degree[new_block] += degree[i];
+    block_size[new_block]++;
+    block_of[i] = new_block;
+
+    if (node_moved) {
+      _synced_block[i] = new_block;
+    } else if (!_is_unsynced[i]) {
+      _is_unsynced[i] = true;
+      _unsynced.push_back(i);
+    }
+  }
+
+  // Give every moved node the block the arrays have it in. When the blocks
+  // are the top of the hierarchy the blocks that changed are rewritten whole:
+  // their children, degrees, and edge counts, with edges_between(r, s)
+  // giving the current count between blocks r and s. Otherwise every moved
+  // node goes through Node::set_parent() so the levels above follow along.
+  template <typename Count_Fn>
+  void sync_nodes(Count_Fn edges_between)
+  {
+    std::vector<int> moved;
+    std::vector<char> block_changed(n_blocks(), false);
+    for (const int i : _unsynced) {
+      _is_unsynced[i] = false;
+      if (block_of[i] == _synced_block[i]) continue;
+
+      moved.push_back(i);
+      block_changed[_synced_block[i]] = true;
+      block_changed[block_of[i]]      = true;
+      _synced_block[i]                = block_of[i];
+    }
+    _unsynced.clear();
+
+    if (!_blocks_on_top) {
+      for (const int i : moved) _nodes[i]->set_parent(_blocks[block_of[i]]);
+      return;
+    }
+
+    for (const int i : moved) _nodes[i]->point_to_parent(_blocks[block_of[i]]);
+
+    // Children that stayed keep their order and newcomers go on the end
+    std::vector<Node_Vec> children(n_blocks());
+    for (int b = 0; b < n_blocks(); b++) {
+      if (!block_changed[b]) continue;
+      for (Node* child : _blocks[b]->children()) {
+        if (child->parent() == _blocks[b]) children[b].push_back(child);
+      }
+    }
+    for (const int i : moved) children[block_of[i]].push_back(_nodes[i]);
+
+    for (int r = 0; r < n_blocks(); r++) {
+      if (block_changed[r]) {
+        _blocks[r]->set_children(std::move(children[r]));
+        _blocks[r]->set_degree(block_degree[r]);
+      }
+      for (int s = 0; s < n_blocks(); s++) {
+        if (block_changed[r] || block_changed[s]) _blocks[r]->set_block_edges(_blocks[s], edges_between(r, s));
+      }
+    }
+  }
+};
@@ -1,6 +1,7 @@
 #include <RcppCommon.h>
 
 #include "SBM.h"
+#include "simulate_network.h"
 
 using Node_Ptr = Node*;
 
@@ -20,6 +21,14 @@ template <>
 SEXP wrap(const Block_Counts&);
 template <>
 SEXP wrap(const Edge_Counts_by_ID&);
+template <>
+SEXP wrap(const Tempering_Results&);
+template <>
+SEXP wrap(const Nested_Results&);
+template <>
+SEXP wrap(const Sparse_Edge_Counts&);
+template <>
+SEXP wrap(const Job_Progress&);
 
 // Create and return dump of state as dataframe
 inline DataFrame state_to_df(const State_Dump& state)
@@ -118,6 +127,16 @@ SEXP wrap(const Edge_Counts_by_ID& edge_counts)
                            _["n_edges"] = counts);
 }
 
+// Vectors are already R vectors so they are handed over as is
+template <>
+SEXP wrap(const Sparse_Edge_Counts& edge_counts)
+{
+  return List::create(_["block_ids"] = edge_counts.block_ids,
+                      _["block_a"]   = edge_counts.block_a,
+                      _["block_b"]   = edge_counts.block_b,
+                      _["n_edges"]   = edge_counts.n_edges);
+}
+
 template <>
 SEXP wrap(const Block_Counts& block_counts)
 {
@@ -136,11 +155,17 @@ SEXP wrap(const Collapse_Results& collapse_results)
                               _["final_entropy"] = collapse_results.final_entropy,
                               _["n_blocks"]      = collapse_results.n_blocks);
 
+  // States go over as the starting partition plus the nodes moved at each
+  // step. Use SBM$restore_collapse_step() to rebuild a given step's state.
+  const Collapse_History& history = collapse_results.states;
+
   auto step_states = List(n_steps);
   for (int i = 0; i < n_steps; i++) {
-    step_states[i] = state_to_df(collapse_results.states[i]);
+    step_states[i] = List::create(_["moved_nodes"] = history.moved_nodes[i],
+                                  _["new_blocks"]  = history.new_blocks[i]);
   }
-  results["step_states"] = step_states;
+  results["initial_state"] = history.initial_state;
+  results["step_states"]   = step_states;
 
   if (all_steps_reported) {
     auto step_merges    = List(n_steps);
@@ -166,8 +191,113 @@ SEXP wrap(const Collapse_Results& collapse_results)
   return results;
 }
 
+template <>
+SEXP wrap(const Tempering_Results& tempering_results)
+{
+  const int n_pairs = tempering_results.n_swaps_proposed.size();
+
+  auto beta_hot  = NumericVector(n_pairs);
+  auto beta_cold = NumericVector(n_pairs);
+  for (int i = 0; i < n_pairs; i++) {
+    beta_cold[i] = tempering_results.betas[i];
+    beta_hot[i]  = tempering_results.betas[i + 1];
+  }
+
+  List results = List::create(_["cold_entropy"] = tempering_results.cold_entropy,
+                              _["swap_info"]    = DataFrame::create(_["beta_cold"]        = beta_cold,
+                                                                 _["beta_hot"]         = beta_hot,
+                                                                 _["n_proposed"]       = tempering_results.n_swaps_proposed,
+                                                                 _["n_accepted"]       = tempering_results.n_swaps_accepted,
+                                                                 _["stringsAsFactors"] = false));
+
+  const int n_states = tempering_results.cold_states.size();
+  if (n_states > 0) {
+    auto cold_states = List(n_states);
+    for (int i = 0; i < n_states; i++) {
+      cold_states[i] = wrap(tempering_results.cold_states[i]);
+    }
+    results["cold_states"] = cold_states;
+  }
+
+  return results;
+}
+
+template <>
+SEXP wrap(const Nested_Results& nested_results)
+{
+  const int n_block_levels = nested_results.n_blocks.size();
+
+  auto levels = IntegerVector(n_block_levels);
+  for (int i = 0; i < n_block_levels; i++) {
+    levels[i] = i + 1;
+  }
+
+  return List::create(_["level_info"]           = DataFrame::create(_["level"]    = levels,
+                                                              _["n_blocks"] = nested_results.n_blocks,
+                                                              _["entropy"]  = nested_results.level_entropy),
+                      _["sweep_entropy_delta"] = nested_results.sweep_entropy_deltas);
+}
+
+template <>
+SEXP wrap(const Job_Progress& progress)
+{
+  return List::create(_["kind"]            = progress.kind,
+                      _["status"]          = progress.status,
+                      _["step"]            = progress.step,
+                      _["n_steps"]         = progress.n_steps,
+                      _["n_blocks"]        = progress.n_blocks,
+                      _["entropy"]         = progress.entropy,
+                      _["acceptance_rate"] = progress.acceptance_rate);
+}
+
 } // End RCPP namespace
 
+// Draws the nodes and edges for sim_sbm_network(). Block pairs are 0-based
+// indices into the block vectors and an empty degree_weights vector turns off
+// degree correction.
+inline Rcpp::List simulate_sbm_network(const std::vector<std::string>& block_names,
+                                       const std::vector<int>& block_sizes,
+                                       const std::vector<int>& block_a,
+                                       const std::vector<int>& block_b,
+                                       const std::vector<double>& propensities,
+                                       const bool poisson,
+                                       const bool allow_self_edges,
+                                       const std::vector<double>& degree_weights,
+                                       const int random_seed)
+{
+  Sampler sampler(random_seed);
+  const auto network = simulate_sbm(block_names,
+                                    block_sizes,
+                                    block_a,
+                                    block_b,
+                                    propensities,
+                                    poisson ? poisson_edges : bernoulli_edges,
+                                    allow_self_edges,
+                                    sampler,
+                                    degree_weights);
+
+  const int n_nodes = network.node_ids.size();
+  const int n_pairs = network.n_edges.size();
+
+  auto node_blocks = Rcpp::CharacterVector(n_nodes);
+  for (int i = 0; i < n_nodes; i++) node_blocks[i] = block_names[network.node_blocks[i]];
+
+  auto from = Rcpp::CharacterVector(n_pairs);
+  auto to   = Rcpp::CharacterVector(n_pairs);
+  for (int e = 0; e < n_pairs; e++) {
+    from[e] = network.node_ids[network.edges_a[e]];
+    to[e]   = network.node_ids[network.edges_b[e]];
+  }
+
+  return Rcpp::List::create(Rcpp::_["nodes"] = Rcpp::DataFrame::create(Rcpp::_["id"]               = network.node_ids,
+                                                                      Rcpp::_["block"]            = node_blocks,
+                                                                      Rcpp::_["stringsAsFactors"] = false),
+                            Rcpp::_["edges"] = Rcpp::DataFrame::create(Rcpp::_["from"]             = from,
+                                                                      Rcpp::_["to"]               = to,
+                                                                      Rcpp::_["edges"]            = network.n_edges,
+                                                                      Rcpp::_["stringsAsFactors"] = false));
+}
+
 RCPP_MODULE(SBM)
 {
   Rcpp::class_<SBM>("SBM")
@@ -195,24 +325,74 @@ RCPP_MODULE(SBM)
                     "Exports the current state of the network as dataframe with each node as a row and columns for node id, parent id, node type, and node level.")
       .const_method("interblock_edge_counts", &SBM::interblock_edge_counts,
                     "Get dataframe of counts of edges between all unique pairs of blocks in network")
+      .const_method("sparse_interblock_edge_counts", &SBM::sparse_interblock_edge_counts,
+                    "Get counts of edges between all connected pairs of blocks at a level as 0-based index triplets into a single vector of block ids")
       .const_method("node_to_block_edge_counts", &SBM::node_to_block_edge_counts,
                     "Get dataframe of a node's edge counts to blocks at a given level.")
       .const_method("entropy", &SBM::entropy,
                     "Calculate the degree corrected entropy of current model state at desired level")
       .method("add_node", &SBM::add_node_no_ret,
-              "Add a node to the network. Takes the node id (string), the node type (string), and the node level (int). Use level = 0 for data-level nodes.")
-      .method("add_edge", &SBM::add_edge,
-              "Connects two nodes in network (at level 0) by their ids (string).")
+              "Add a node to the network. Takes the node id (string), the node type (string), and the node level (int). Use level = 0 for data-level nodes. Data nodes added to a model with blocks start in a random block until SBM$place_new_nodes() is run.")
+      .method("add_edge", &SBM::add_edge_unweighted,
+              "Connects two nodes in network (at level 0) by their ids (string). Models with blocks keep their block edge counts current.")
+      .method("add_weighted_edge", &SBM::add_edge,
+              "Connects two nodes in network (at level 0) by their ids (string) with a given number of edges (int).")
       .method("add_edges", &SBM::add_edges,
-              "Takes two character vectors of node ids (string) and connects the nodes with edges in network")
+              "Takes two character vectors of node ids (string) and connects the nodes with edges in network. Also takes the allowed edge type pairs and an optional integer vector of edge weights (empty for all ones).")
+      .method("reorder_nodes", &SBM::reorder_nodes,
+              "Lays data nodes out in memory by a given order, rcm (reverse Cuthill-McKee) or degree, so connected nodes sit close together. Takes the order (string) and how many consecutive nodes sweeps shuffle together (int, 1 for a plain shuffle). Must be called before blocks are added.")
       .method("initialize_blocks", &SBM::initialize_blocks,
               "Adds a desired number of blocks and randomly assigns them for a given level. n_blocks = -1 means every node gets their own block")
       .method("reset_blocks", &SBM::reset_blocks,
               "Erases all block levels in network.")
-      .method("update_state", &SBM::update_state,
+      .const_method("compact_state", &SBM::compact_state,
+                    "Exports the current state as a list with an integer vector per level giving the 0-based index of each node's parent in the level above. Data nodes are ordered as in SBM$data_node_ids().")
+      .const_method("data_node_ids", &SBM::data_node_ids,
+                    "Ids of the data-level nodes in the order used by compact states.")
+      .method("update_state", static_cast<void (SBM::*)(const InOut_String_Vec&, const InOut_String_Vec&, const InOut_String_Vec&, const InOut_Int_Vec&)>(&SBM::update_state),
               "Takes model state export as given by SBM$state() and returns model to specified state. This is useful for resetting model before running various algorithms such as agglomerative merging.")
+      .method("update_compact_state", static_cast<void (SBM::*)(const Compact_State&)>(&SBM::update_state),
+              "Takes a compact state as given by SBM$compact_state() and returns model to specified state.")
+      .method("restore_collapse_step", &SBM::restore_collapse_step,
+              "Returns model to the state after a given step (0-based) of a collapse. Takes the initial state and the per-step moved nodes and new blocks from collapse results.")
       .method("mcmc_sweep", &SBM::mcmc_sweep,
-              "Runs a single MCMC sweep across all nodes at specified level. Each node is given a chance to move blocks or stay in current block and all nodes are processed in random order. Takes the level that the sweep should take place on (int) and if new blocks blocks can be proposed and empty blocks removed (boolean).")
+              "Runs a single MCMC sweep across all nodes at specified level. Each node is given a chance to move blocks or stay in current block and all nodes are processed in random order. Takes the level that the sweep should take place on (int) and if new blocks blocks can be proposed and empty blocks removed (boolean). Last argument switches from Metropolis-Hastings moves to heat-bath draws over all blocks.")
+      .method("place_new_nodes", &SBM::place_new_nodes,
+              "Moves nodes added since blocks were assigned into the block of their type that fits their edges best, then runs a given number of sweeps over just the new nodes, the ends of new edges, and their neighbors. Takes the number of sweeps and eps. First entry of the results is the placement.")
+      .method("warm_start", &SBM::warm_start,
+              "Loads blocks from a state of an earlier snapshot of the network (ids, types, parents, and levels). Nodes no longer in the network and blocks left empty are dropped. Nodes missing from the state are placed into the block of their type that fits their edges best. Last argument is eps. Returns the number of nodes that were new to the state.")
+      .const_method("n_unplaced_nodes", &SBM::n_unplaced_nodes,
+                    "Number of nodes added since blocks were assigned that are still waiting on SBM$place_new_nodes() (nodes without edges keep waiting).")
+      .method("replica_exchange", &SBM::replica_exchange,
+              "Runs parallel tempering with one replica of the model per inverse temperature, each on its own thread. Takes a vector of inverse temperatures (first must be 1), number of rounds, sweeps per round, eps, if the number of blocks can vary, the level to sweep, and if the cold chain's state should be recorded after each round. Model is left in the final state of the cold chain.")
+      .method("fit_nested", &SBM::fit_nested,
+              "Builds a full hierarchy of blocks by repeatedly merging each level's blocks into a smaller level above it until a single block per node type remains. Then sweeps all levels together. Takes the ratio of block counts between levels, number of merge checks per block, MCMC sweeps between merges, number of nested sweeps, sigma, eps, and if exhaustive merge checks are allowed.")
       .method("collapse_blocks", &SBM::collapse_blocks,
-              "Performs agglomerative merging on network, starting with each block has a single node down to one block per node type. Arguments are level to perform merge at (int) and number of MCMC steps to peform between each collapsing to equilibriate block. Returns list with entropy and model state at each merge.");
+              "Performs agglomerative merging on network, starting with each block has a single node down to one block per node type. Arguments are level to perform merge at (int) and number of MCMC steps to peform between each collapsing to equilibriate block. Returns list with entropy and model state at each merge.")
+      .method("start_sweep_job", &SBM::start_sweep_job,
+              "Starts MCMC sweeps on a copy of the model in a background thread and returns right away. Takes the number of sweeps, eps, if the number of blocks can vary, if pairs should be tracked, the level to sweep, and if heat-bath moves should be used.")
+      .method("start_collapse_job", &SBM::start_collapse_job,
+              "Starts an agglomerative collapse on a copy of the model in a background thread and returns right away. Takes the same arguments as SBM$collapse_blocks().")
+      .const_method("has_job", &SBM::has_job,
+                    "Does the model have a background job that hasn't been collected?")
+      .const_method("job_progress", &SBM::job_progress,
+                    "Returns a list with the background job's kind, status, steps done, steps asked for, current number of blocks, entropy, and move acceptance rate.")
+      .method("cancel_job", &SBM::cancel_job,
+              "Asks the background job to stop at its next check in. Work done so far can still be collected.")
+      .method("collect_sweep_job", &SBM::collect_sweep_job,
+              "Waits for a background sweep job to end, moves the model to the job's final state, and returns the sweep results.")
+      .method("collect_collapse_job", &SBM::collect_collapse_job,
+              "Waits for a background collapse job to end, moves the model to the job's final state, and returns the collapse results.")
+      .method("set_checkpoint", &SBM::set_checkpoint,
+              "Makes SBM$mcmc_sweep() and SBM$collapse_blocks() save their progress to a binary file. Takes the file path and how many sweeps or merge steps go between checkpoints (0 turns checkpoints off).")
+      .method("resume_sweep", &SBM::resume_sweep,
+              "Picks an interrupted SBM$mcmc_sweep() back up from its checkpoint file and returns the results of the whole run. Model must be built the same way as the one that wrote the checkpoint.")
+      .method("resume_collapse", &SBM::resume_collapse,
+              "Picks an interrupted SBM$collapse_blocks() back up from its checkpoint file and returns the results of the whole run. Model must be built the same way as the one that wrote the checkpoint.");
+
+  Rcpp::function("checkpoint_kind", &checkpoint_kind,
+                 "Reads what kind of run (sweep or collapse) a checkpoint file was written by.");
+
+  Rcpp::function("simulate_sbm_network", &simulate_sbm_network,
+                 "Simulates nodes and edges from a stochastic block model. Takes block names, block sizes, the 0-based block indices and propensity of each connected block pair, if edge counts are Poisson (otherwise Bernoulli), if self edges are allowed, per node degree weights (empty for none), and a random seed. Returns a list with a nodes and an edges dataframe.");
 };
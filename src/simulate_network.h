@@ -0,0 +1,259 @@
+#pragma once
+
+#include "Flat_Hash_Map.h"
+#include "SBM.h"
+#include "Sampler.h"
+
+#include <cstdint>
+#include <random>
+
+// =============================================================================
+// Simulating networks from the stochastic block model
+// =============================================================================
+// Edges are drawn per pair of blocks rather than per pair of nodes, so the work
+// is proportional to the number of edges drawn instead of the number of node
+// pairs. Under the Poisson model the total edge count for a pair of blocks is
+// drawn first and each edge's ends are then placed on nodes in proportion to
+// their degree weights (uniformly without degree correction). Bernoulli draws
+// without degree correction skip geometrically distributed runs of empty node
+// pairs. Degree corrected Bernoulli draws are Poisson draws capped at one edge,
+// so a pair is connected with probability 1 - exp(-theta_i * theta_j * p).
+
+enum Edge_Dist { poisson_edges,
+                 bernoulli_edges };
+
+struct Simulated_Network {
+  std::vector<string> node_ids;
+  std::vector<int> node_blocks; // Index into the block list for each node
+  std::vector<int> edges_a;     // Index into node_ids of each edge's ends
+  std::vector<int> edges_b;
+  std::vector<int> n_edges; // Number of edges between each pair
+};
+
+// Walker's alias method for O(1) draws from a fixed discrete distribution
+class Alias_Table {
+  private:
+  std::vector<double> _prob;
+  std::vector<int> _alias;
+
+  public:
+  explicit Alias_Table(const std::vector<double>& weights)
+      : _prob(weights.size())
+      , _alias(weights.size())
+  {
+    const int n        = weights.size();
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+
+    std::vector<int> small, large;
+    for (int i = 0; i < n; i++) {
+      _prob[i] = weights[i] * n / total;
+      (_prob[i] < 1.0 ? small : large).push_back(i);
+    }
+
+    while (!small.empty() && !large.empty()) {
+      const int s = small.back();
+      const int l = large.back();
+      small.pop_back();
+
+      _alias[s] = l;
+      _prob[l] -= 1.0 - _prob[s];
+      if (_prob[l] < 1.0) {
+        large.pop_back();
+        small.push_back(l);
+      }
+    }
+
+    // Anything left is only off from one by rounding
+    for (const int i : small) _prob[i] = 1.0;
+    for (const int i : large) _prob[i] = 1.0;
+  }
+
+  int draw(Sampler& sampler) const
+  {
+    const int i = sampler.get_rand_int(_prob.size() - 1);
+    return sampler.draw_unif() < _prob[i] ? i : _alias[i];
+  }
+};
+
+// Each row of block_a, block_b, and propensities gives the edge propensity
+// between a pair of blocks (0-based indices into block_sizes), pairs not listed
+// get no edges. Nodes are named "<block name>_<i>" with i starting at one.
+// degree_weights, when given, holds a positive weight for each node in the
+// order the nodes are generated. Weights are normalized to average one within
+// each block so propensities keep their meaning.
+inline Simulated_Network simulate_sbm(const std::vector<string>& block_names,
+                                      const std::vector<int>& block_sizes,
+                                      const std::vector<int>& block_a,
+                                      const std::vector<int>& block_b,
+                                      const std::vector<double>& propensities,
+                                      const Edge_Dist edge_dist,
+                                      const bool allow_self_edges,
+                                      Sampler& sampler,
+                                      const std::vector<double>& degree_weights = {})
+{
+  const int n_blocks = block_sizes.size();
+  if (block_names.size() != n_blocks) LOGIC_ERROR("Need a name for every block");
+  if (block_a.size() != propensities.size() || block_b.size() != propensities.size()) {
+    LOGIC_ERROR("Need a pair of blocks for every propensity");
+  }
+
+  Simulated_Network network;
+
+  // Blocks hold a contiguous run of nodes
+  std::vector<int> block_start(n_blocks + 1, 0);
+  for (int r = 0; r < n_blocks; r++) {
+    if (block_sizes[r] < 0) LOGIC_ERROR("Block sizes can't be negative");
+    block_start[r + 1] = block_start[r] + block_sizes[r];
+  }
+  const int n_nodes = block_start[n_blocks];
+
+  network.node_ids.reserve(n_nodes);
+  network.node_blocks.reserve(n_nodes);
+  for (int r = 0; r < n_blocks; r++) {
+    for (int i = 1; i <= block_sizes[r]; i++) {
+      network.node_ids.push_back(block_names[r] + "_" + as_str(i));
+      network.node_blocks.push_back(r);
+    }
+  }
+
+  // Degree weights and the node pickers that follow them
+  const bool degree_corrected = !degree_weights.empty();
+  if (degree_corrected && degree_weights.size() != n_nodes) LOGIC_ERROR("Need a degree weight for every node");
+
+  std::vector<double> sum_sq_weights(n_blocks); // Sum of squared normalized weights per block
+  std::vector<Alias_Table> node_pickers;
+  for (int r = 0; r < n_blocks; r++) {
+    if (!degree_corrected) {
+      sum_sq_weights[r] = block_sizes[r];
+      continue;
+    }
+
+    std::vector<double> weights(degree_weights.begin() + block_start[r],
+                                degree_weights.begin() + block_start[r + 1]);
+    const double total = std::accumulate(weights.begin(), weights.end(), 0.0);
+    if (std::any_of(weights.begin(), weights.end(), [](const double w) { return w < 0; })) {
+      LOGIC_ERROR("Degree weights can't be negative");
+    }
+    if (block_sizes[r] > 0 && total <= 0) LOGIC_ERROR("Every block needs a positive total degree weight");
+
+    for (auto& w : weights) {
+      w *= block_sizes[r] / total;
+      sum_sq_weights[r] += w * w;
+    }
+    node_pickers.emplace_back(block_sizes[r] > 0 ? weights : std::vector<double> { 1.0 });
+  }
+
+  const auto pick_node = [&](const int r) {
+    return block_start[r] + (degree_corrected ? node_pickers[r].draw(sampler) : sampler.get_rand_int(block_sizes[r] - 1));
+  };
+
+  // Edge counts keyed by the two node indices, lower one first
+  Flat_Hash_Map<std::uint64_t, int> pair_counts;
+  const auto add_edge = [&](int a, int b) {
+    if (a > b) std::swap(a, b);
+    pair_counts[(std::uint64_t(a) << 32) | std::uint64_t(b)]++;
+  };
+
+  for (int row = 0; row < propensities.size(); row++) {
+    const int r         = block_a[row];
+    const int s         = block_b[row];
+    const double lambda = propensities[row];
+    if (r < 0 || s < 0 || r >= n_blocks || s >= n_blocks) RANGE_ERROR("Propensity given for a block that doesn't exist");
+    if (lambda <= 0 || block_sizes[r] == 0 || block_sizes[s] == 0) continue;
+
+    const double n_r = block_sizes[r];
+    const double n_s = block_sizes[s];
+
+    if (edge_dist == bernoulli_edges && !degree_corrected) {
+      // Walk the node pairs of the two blocks in order, jumping straight from
+      // one connected pair to the next
+      const long long n_pairs = r != s ? (long long)(n_r * n_s)
+                                       : (long long)(n_r * (n_r + (allow_self_edges ? 1 : -1)) / 2);
+      std::geometric_distribution<long long> gap(std::min(lambda, 1.0));
+
+      // Position within the triangle of within block pairs
+      int row_i = 0;
+      long long row_start = 0;
+      const auto row_length = [&](const int i) { return block_sizes[r] - i - (allow_self_edges ? 0 : 1); };
+
+      for (long long k = lambda >= 1 ? 0 : gap(sampler.generator); k < n_pairs;
+           k += 1 + (lambda >= 1 ? 0 : gap(sampler.generator))) {
+        if (r != s) {
+          add_edge(block_start[r] + k / block_sizes[s], block_start[s] + k % block_sizes[s]);
+          continue;
+        }
+
+        while (k >= row_start + row_length(row_i)) row_start += row_length(row_i++);
+        const int col = row_i + int(k - row_start) + (allow_self_edges ? 0 : 1);
+        add_edge(block_start[r] + row_i, block_start[r] + col);
+      }
+      continue;
+    }
+
+    // Poisson: expected edges summed over all node pairs of the two blocks.
+    // Normalized weights sum to the block size.
+    const double expected_edges = r != s
+        ? lambda * n_r * n_s
+        : lambda * (n_r * n_r + (allow_self_edges ? 1 : -1) * sum_sq_weights[r]) / 2;
+    if (expected_edges <= 0) continue;
+
+    const long long n_drawn = std::poisson_distribution<long long>(expected_edges)(sampler.generator);
+    for (long long e = 0; e < n_drawn; e++) {
+      int a = pick_node(r);
+      int b = pick_node(s);
+
+      // Within a block each unordered pair comes from only one of its two
+      // ordered draws
+      if (r == s) {
+        while (a > b || (a == b && !allow_self_edges)) {
+          a = pick_node(r);
+          b = pick_node(r);
+        }
+      }
+      add_edge(a, b);
+    }
+  }
+
+  const bool cap_at_one = edge_dist == bernoulli_edges;
+  network.edges_a.reserve(pair_counts.size());
+  network.edges_b.reserve(pair_counts.size());
+  network.n_edges.reserve(pair_counts.size());
+  for (const auto& pair_count : pair_counts) {
+    network.edges_a.push_back(int(pair_count.first >> 32));
+    network.edges_b.push_back(int(pair_count.first & 0xffffffffULL));
+    network.n_edges.push_back(cap_at_one ? 1 : pair_count.second);
+  }
+
+  return network;
+}
+
+// Load a simulated network straight into a model. Nodes take the type of their
+// block, or "node" for every block if no types are given.
+inline SBM simulated_sbm(const Simulated_Network& network,
+                         const std::vector<string>& block_types = {},
+                         const int random_seed                  = 42)
+{
+  std::vector<string> unique_types;
+  for (const auto& type : block_types) {
+    if (std::find(unique_types.begin(), unique_types.end(), type) == unique_types.end()) unique_types.push_back(type);
+  }
+  if (unique_types.empty()) unique_types.push_back("node");
+
+  auto all_types = InOut_String_Vec(unique_types.size());
+  for (int t_i = 0; t_i < unique_types.size(); t_i++) all_types[t_i] = unique_types[t_i];
+
+  SBM my_sbm(all_types, random_seed);
+
+  Node_Vec nodes;
+  nodes.reserve(network.node_ids.size());
+  for (int i = 0; i < network.node_ids.size(); i++) {
+    const string& type = block_types.empty() ? unique_types[0] : block_types.at(network.node_blocks[i]);
+    nodes.push_back(my_sbm.add_node(network.node_ids[i], type));
+  }
+
+  for (int e = 0; e < network.n_edges.size(); e++) {
+    my_sbm.add_edge_between(nodes[network.edges_a[e]], nodes[network.edges_b[e]], network.n_edges[e]);
+  }
+
+  return my_sbm;
+}
@@ -2,7 +2,10 @@
 #define __VECTOR_HELPERS_INCLUDED__
 
 #include "error_and_message_macros.h"
+#include <algorithm>
 #include <map>
+#include <memory>
+#include <numeric>
 #include <random>
 #include <utility>
 #include <vector>